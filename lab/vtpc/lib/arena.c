@@ -0,0 +1,61 @@
+#define _GNU_SOURCE
+#include "arena.h"
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20U)
+
+static size_t align_up(size_t value, size_t align) {
+  return (value + align - 1) & ~(align - 1);
+}
+
+int vtpc_arena_map(struct vtpc_arena* arena, size_t size, int huge) {
+  int prot = PROT_READ | PROT_WRITE;
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  void* base = MAP_FAILED;
+  if (huge == VTPC_HUGE_TLB) {
+    size = align_up(size, HUGE_PAGE_SIZE);
+    base = mmap(NULL, size, prot, flags | MAP_HUGETLB, -1, 0);
+  }
+  if (base == MAP_FAILED) {
+    base = mmap(NULL, size, prot, flags, -1, 0);
+    if (base == MAP_FAILED) {
+      return -1;
+    }
+    if (huge != VTPC_HUGE_NONE) {
+      // Only a hint: without THP support the arena stays on small pages.
+      (void)madvise(base, size, MADV_HUGEPAGE);
+    }
+  }
+
+  arena->base = base;
+  arena->size = size;
+  arena->used = 0;
+  return 0;
+}
+
+int vtpc_arena_map_fd(struct vtpc_arena* arena, int fd, size_t size) {
+  void* base =
+      mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    return -1;
+  }
+  arena->base = base;
+  arena->size = size;
+  arena->used = 0;
+  return 0;
+}
+
+void vtpc_arena_unmap(struct vtpc_arena* arena) {
+  if (arena->base != NULL) {
+    (void)munmap(arena->base, arena->size);
+    arena->base = NULL;
+  }
+}
+
+void* vtpc_arena_take(struct vtpc_arena* arena, size_t size, size_t align) {
+  size_t offset = align_up(arena->used, align);
+  arena->used = offset + size;
+  return (arena->base != NULL) ? arena->base + offset : NULL;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+
+// Huge page backing of an arena.
+#define VTPC_HUGE_NONE 0
+#define VTPC_HUGE_ADVISE 1  // transparent huge pages, if the kernel agrees
+#define VTPC_HUGE_TLB 2     // reserved huge pages, falling back to ADVISE
+
+// One mapping carved into pieces by bump allocation. Laying out an arena
+// that is not mapped yet only measures it: every piece comes back NULL and
+// `used` ends up as the size to map.
+struct vtpc_arena {
+  char* base;
+  size_t size;
+  size_t used;
+};
+
+// Maps `size` zeroed bytes. Returns -1 with errno set on failure.
+int vtpc_arena_map(struct vtpc_arena* arena, size_t size, int huge);
+// Maps the first `size` bytes of a file shared with other processes.
+int vtpc_arena_map_fd(struct vtpc_arena* arena, int fd, size_t size);
+void vtpc_arena_unmap(struct vtpc_arena* arena);
+
+// Takes the next `size` bytes aligned to `align`, a power of two.
+void* vtpc_arena_take(struct vtpc_arena* arena, size_t size, size_t align);
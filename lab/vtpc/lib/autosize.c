@@ -0,0 +1,72 @@
+#define _GNU_SOURCE
+#include "autosize.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "cache.h"
+
+uint32_t vtpc_autosize_knee(const struct vtpc_stats* curve, uint32_t budget) {
+  if (curve->mrc_step == 0 || curve->mrc_accesses < budget) {
+    return 0;
+  }
+  uint64_t points = budget / curve->mrc_step;
+  if (points > VTPC_MRC_POINTS) {
+    points = VTPC_MRC_POINTS;
+  }
+  if (points == 0) {
+    return 0;
+  }
+  uint64_t best = curve->mrc_hits[points - 1];
+  uint64_t slack = curve->mrc_accesses * VTPC_AUTOSIZE_SLACK / 100;
+  uint64_t knee = points - 1;
+  while (knee > 0 && curve->mrc_hits[knee - 1] + slack >= best) {
+    --knee;
+  }
+  return (uint32_t)((knee + 1) * curve->mrc_step);
+}
+
+static void* autosize_main(void* arg) {
+  uint32_t budget = (uint32_t)(uintptr_t)arg;
+  struct vtpc_stats last;
+  vtpc_cache_stats(-1, &last);
+  while (true) {
+    struct timespec interval = {
+        .tv_sec = VTPC_AUTOSIZE_INTERVAL_MS / 1000,
+        .tv_nsec = (VTPC_AUTOSIZE_INTERVAL_MS % 1000) * 1000000L,
+    };
+    while (nanosleep(&interval, &interval) == -1 && errno == EINTR) {
+    }
+
+    // Only what was measured since the last look counts.
+    struct vtpc_stats now;
+    vtpc_cache_stats(-1, &now);
+    struct vtpc_stats window = now;
+    window.mrc_accesses -= last.mrc_accesses;
+    for (int i = 0; i < VTPC_MRC_POINTS; ++i) {
+      window.mrc_hits[i] -= last.mrc_hits[i];
+    }
+    last = now;
+
+    uint32_t knee = vtpc_autosize_knee(&window, budget);
+    if (knee > 0) {
+      // Fails below the number of shards, which leaves the size as it is.
+      (void)vtpc_cache_resize(knee);
+    }
+  }
+  return NULL;
+}
+
+int vtpc_autosize_start(uint32_t budget) {
+  pthread_t thread;
+  int result =
+      pthread_create(&thread, NULL, autosize_main, (void*)(uintptr_t)budget);
+  if (result != 0) {
+    errno = result;
+    return -1;
+  }
+  (void)pthread_detach(thread);
+  return 0;
+}
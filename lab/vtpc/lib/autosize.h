@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "vtpc.h"
+
+// Time between two looks of the autosizer at the miss-ratio curve.
+#define VTPC_AUTOSIZE_INTERVAL_MS 10000
+// Percentage of accesses a smaller cache may miss more than the budget
+// would and still count as good enough.
+#define VTPC_AUTOSIZE_SLACK 1
+
+// Returns the size at the knee of the curve in the mrc_* fields of `curve`
+// within `budget` blocks: the smallest point of the curve that hits within
+// VTPC_AUTOSIZE_SLACK percent of accesses as often as the largest point
+// within the budget. Returns 0 if there are fewer accesses than blocks in
+// the budget or no point of the curve within it.
+uint32_t vtpc_autosize_knee(const struct vtpc_stats* curve, uint32_t budget);
+
+// Starts a thread that every VTPC_AUTOSIZE_INTERVAL_MS sets the capacity
+// of the cache to the knee of the curve measured since its last look.
+int vtpc_autosize_start(uint32_t budget);
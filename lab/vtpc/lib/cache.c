@@ -0,0 +1,3251 @@
+#define _GNU_SOURCE
+#include "cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "autosize.h"
+#include "index.h"
+#include "io.h"
+#include "list.h"
+#include "lz.h"
+#include "manifest.h"
+#include "mrc.h"
+#include "policy.h"
+#include "psi.h"
+
+#define KEY_FILE_SHIFT 40U
+#define MAX_OFFSET ((uint64_t)VTPC_BLOCK_SIZE << KEY_FILE_SHIFT)
+
+// Longest run of adjacent blocks moved with one preadv or pwritev.
+#define RUN_MAX 256
+#define READAHEAD_MIN 4
+#define READAHEAD_MAX 128
+
+// A sequential stream counts as a scan once its readahead window has grown
+// past the first step, and the blocks it loads go on probation.
+#define SCAN_WINDOW (2 * READAHEAD_MIN)
+#define SCAN_RATIO_DEFAULT 12
+
+// Under memory pressure the cache gives up a quarter of its blocks at
+// a time, but keeps an eighth of its capacity; it takes them back an eighth
+// at a time once the pressure is gone.
+#define PRESSURE_SHRINK_DIV 4
+#define PRESSURE_GROW_DIV 8
+#define PRESSURE_FLOOR_DIV 8
+
+// Clean blocks evicted from a shard are kept in its part of the compressed
+// tier if they shrink to at most ZPOOL_ENTRY_MAX bytes. The tier is a ring
+// of ZPOOL_UNIT-byte units that drops its oldest entries to make room.
+#define ZPOOL_UNIT 16U
+#define ZPOOL_ENTRY_MAX (VTPC_BLOCK_SIZE / 2)
+#define ZPOOL_MAX (UINT32_MAX / (VTPC_BLOCK_SIZE / ZPOOL_UNIT))
+
+// A sync may wait up to a second for others to join it.
+#define SYNC_WINDOW_MAX_US 1000000U
+
+// The miss-ratio curve is estimated from about this many sampled blocks,
+// over twice the capacity laid out.
+#define MRC_SAMPLES 8192U
+
+// Blocks are spread over shards in extents of 64 consecutive blocks, so
+// that runs mostly stay within one shard.
+#define EXTENT_SHIFT 6U
+#define SHARDS_MAX 64
+#define SHARDS_DEFAULT_MAX 16
+#define SHARD_MIN_FRAMES 32
+
+// A shared segment admits up to PEERS_MAX processes at once. Waits in it
+// give up every REAP_INTERVAL_NS to check for peers that died meanwhile.
+#define SHM_MAGIC 0x7674706373686d31ULL  // "vtpcshm1"
+#define PEERS_MAX 64
+#define REAP_INTERVAL_NS 100000000L
+#define POLICY_NAME_MAX 16
+
+// Locks are taken in the order resize, peers, handle, shard, files, file,
+// flush, fds, mrc. No lock is held across disk I/O, except a shard lock while
+// evicting a dirty victim or shrinking the shard.
+
+// A condition variable that outlives its waiters: a peer that dies in
+// a wait on a process-shared pthread_cond_t can leave it blocking every
+// later broadcast. Wakeups may be spurious; waiters recheck under the lock.
+struct event {
+  _Atomic uint32_t seq;
+  _Atomic uint32_t waiters;
+};
+
+enum stat_id {
+  STAT_HITS,
+  STAT_MISSES,
+  STAT_EVICTIONS,
+  STAT_WRITEBACKS,
+  STAT_READAHEAD,
+  STAT_READAHEAD_HITS,
+  STAT_READAHEAD_WASTED,
+  STAT_COMPRESSED,
+  STAT_COMPRESSED_HITS,
+  STAT_COUNT,
+};
+
+// One per inode: every handle opened on the same (st_dev, st_ino) shares
+// the slot, and with it the cached blocks and the dirty set. In a shared
+// segment a slot outlives its last handle, keeping the blocks warm for the
+// next process to open the file.
+struct file {
+  pthread_mutex_t lock;
+  struct event io_done;  // some writeback of this file finished
+  struct event synced;   // a sync of this file finished
+  bool used;               // guarded by files_lock and the file lock
+  bool closing;            // guarded by files_lock, as are the next three
+  int closer;              // peer running the last close while `closing`
+  uint32_t refs;           // handles open in all processes
+  uint32_t generation;     // bumped whenever the slot is taken anew
+  dev_t dev;
+  ino_t ino;
+  struct timespec mtime;  // as the last close left the file, when idle
+  off_t size;             // logical size as seen through vtpc
+  off_t disk_size;        // size on disk, rounded up by block-sized writes
+  struct vtpc_list dirty;
+  uint32_t writeback;  // frames of this file being written without a lock
+  // Syncs are numbered as they start to flush. Callers that come while one
+  // gathers join it; while one flushes, they gather the next.
+  uint64_t syncs_begun;
+  uint64_t syncs_done;
+  int sync_leader;  // peer running the next sync, or -1
+  int sync_error;   // errno of the last sync, 0 if it succeeded
+  uint64_t stats[STAT_COUNT];  // atomic
+};
+
+// Guarded by the lock of the shard the frame belongs to. A frame keeps its
+// identity while it is on a dirty list, so the file lock suffices to read
+// it from there.
+struct frame {
+  int file;       // -1 when the frame is free
+  uint32_t next;  // free list while the frame is free
+  off_t block;
+  bool dirty;
+  bool loading;  // being read without the shard lock
+  bool writeback;
+  bool prefetched;   // loaded by readahead and not accessed since
+  bool cold;         // on the probation list rather than with the policy
+  int owner;         // peer doing the I/O while loading or in writeback
+  uint32_t pins;     // read views borrowing the block
+  uint32_t valid;    // bytes before it are only on the disk, see frame_fill()
+  uint64_t touched;  // time of the last access, see touch_time()
+};
+
+// A compressed block in the ring of a shard, followed by its data and
+// guarded by the shard lock. Entries of the same block never coexist, nor
+// does an entry with a frame of its block.
+struct zentry {
+  uint64_t key;
+  uint32_t next;  // hash chain, as the unit the next entry starts at
+  uint16_t size;  // compressed bytes, 0 for an entry dropped or padding
+  uint16_t span;  // units taken, the header included
+};
+
+struct shard {
+  pthread_mutex_t lock;
+  struct event io_done;  // a frame finished loading or writeback
+  uint32_t base;           // first frame; policies see `idx - base`
+  uint32_t capacity;
+  uint32_t limit;  // frames in use at most; those past it are offline
+  uint32_t free;
+  uint32_t loading;
+  uint32_t pinned;  // frames with pins
+  // Blocks loaded by scans, newest first, which the policy never sees.
+  // Scans recycle their own frames once they hold `probation_min` of them;
+  // a random access promotes a block to the policy.
+  struct vtpc_list probation;
+  uint32_t probation_min;  // 0 when scans are treated like other reads
+  // The part of the compressed tier, entries from `ztail` up to `zhead`.
+  uint32_t zbase;  // first unit in the tier
+  uint32_t zsize;  // units, 0 without a tier
+  uint32_t zmask;
+  uint32_t zhead;
+  uint32_t ztail;
+  uint32_t zused;
+  uint64_t stats[STAT_COUNT];
+};
+
+// A process using the cache. Each holds the `life` lock of its slot for as
+// long as it runs, so that the others learn of its death from the lock.
+struct peer {
+  pthread_mutex_t life;
+  bool used;  // guarded by peers_lock
+  pid_t pid;
+  uint16_t refs[VTPC_MAX_FILES];  // handles per file, guarded by files_lock
+};
+
+// What all processes attached to the cache have in common, at the start
+// of the arena.
+struct shared {
+  uint64_t magic;  // set once the segment is fully set up
+  size_t size;
+  uint32_t capacity;  // frames laid out, of which `active` are in use
+  uint32_t shard_count;
+  uint32_t zpool;  // blocks' worth of memory for the compressed tier
+  uint32_t mrc;    // blocks sampled for the miss-ratio curve, 0 for none
+  char policy[POLICY_NAME_MAX];
+
+  pthread_mutex_t files_lock;
+  struct event files_closed;  // a last close finished
+  pthread_mutex_t peers_lock;
+
+  pthread_mutex_t flush_lock;
+  struct event flush_wake;  // dirty blocks crossed the background mark
+  struct event flush_done;  // some dirty blocks were written back
+  _Atomic uint32_t dirty;
+  _Atomic uint32_t dirty_background;  // the flusher writes above this mark
+  _Atomic uint32_t dirty_limit;       // writers wait above this mark
+
+  // Guarded by resize_lock, as are the limits of the shards.
+  pthread_mutex_t resize_lock;
+  uint32_t target;  // capacity last set through vtpc_set_capacity()
+  uint32_t active;  // the target, or less under memory pressure
+  uint32_t background_ratio;  // of `active`, to place the marks
+  uint32_t limit_ratio;
+  uint32_t scan_ratio;
+
+  pthread_mutex_t mrc_lock;  // guards the estimator of the curve
+};
+
+// The process' view of the cache. All pointers lead into the arena, which
+// other processes may have mapped elsewhere.
+static struct {
+  uint32_t capacity;
+  uint32_t shard_count;
+  uint32_t zpool;
+  uint32_t mrc;
+  long sync_window_ns;
+  uint32_t peer_count;
+  bool shm;  // the arena is a segment shared with other processes
+  int peer;  // slot of this process in `peers`
+  struct shared* shared;
+  struct file* files;
+  struct peer* peers;
+  char (*paths)[PATH_MAX];  // of the files, to reopen them; shm only
+  char* data;
+  struct frame* frames;
+  struct vtpc_link* dirty_links;  // guarded by the file lock
+  struct vtpc_link* probation_links;
+  struct shard* shards;
+  struct vtpc_index* indexes[SHARDS_MAX];
+  void* policy_states[SHARDS_MAX];
+  char* zdata;
+  uint32_t* zbuckets[SHARDS_MAX];
+  struct vtpc_mrc* mrc_state;  // NULL unless the curve is estimated
+  const struct vtpc_policy* policy;
+  bool flusher;
+} cache;
+
+// Descriptors of this process for the files, by slot. A descriptor stays
+// valid for as long as the slot keeps its generation.
+static pthread_mutex_t fds_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+  int fd;
+  uint32_t generation;
+  bool read_only;  // opened O_RDONLY, so writes to the file fail with EBADF
+} fds[VTPC_MAX_FILES];
+
+// Manifests of the files this process opened, when VTPC_MANIFEST is set.
+// Guarded by fds_lock.
+static const char* manifest_suffix;
+static struct {
+  char* path;
+  bool due;  // the file was opened afresh and is to be warmed up
+} manifests[VTPC_MAX_FILES];
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static int init_errno;
+
+static int parse_env(
+    const char* name, uint32_t fallback, uint32_t max, uint32_t* out
+) {
+  const char* text = getenv(name);
+  if (text == NULL || *text == '\0') {
+    *out = fallback;
+    return 0;
+  }
+  char* end = NULL;
+  errno = 0;
+  unsigned long value = strtoul(text, &end, 10);  // NOLINT
+  if (errno != 0 || *end != '\0' || value > max) {
+    errno = EINVAL;
+    return -1;
+  }
+  *out = (uint32_t)value;
+  return 0;
+}
+
+static void* flusher_main(void* arg);
+static void peers_reap(void);
+static int cache_resize(uint32_t capacity);
+static void manifests_save(void);
+
+static uint32_t default_shards(uint32_t capacity) {
+  uint32_t shards = 1;
+  while (2 * shards <= SHARDS_DEFAULT_MAX &&
+         capacity / (2 * shards) >= SHARD_MIN_FRAMES) {
+    shards *= 2;
+  }
+  return shards;
+}
+
+// The part of `total` frames that falls to `shard`, so that every shard
+// holds its share of any capacity.
+static uint32_t shard_share(uint32_t shard, uint32_t total) {
+  uint32_t size = total / cache.shard_count;
+  return size + ((shard < total % cache.shard_count) ? 1 : 0);
+}
+
+static uint32_t shard_size(uint32_t shard) {
+  return shard_share(shard, cache.capacity);
+}
+
+static uint32_t shard_buckets(uint32_t size) {
+  uint32_t buckets = 1;
+  while (buckets < 2 * size) {
+    buckets <<= 1U;
+  }
+  return buckets;
+}
+
+// Units of the compressed tier that fall to `shard`.
+static uint32_t zpool_share(uint32_t shard) {
+  return shard_share(shard, cache.zpool) * (VTPC_BLOCK_SIZE / ZPOOL_UNIT);
+}
+
+// Entries take two units at least; chains stay short even if all do.
+static uint32_t zpool_buckets(uint32_t units) {
+  return shard_buckets(units / 16);
+}
+
+static struct vtpc_index* shard_index(const struct shard* shard) {
+  return cache.indexes[shard - cache.shards];
+}
+
+static void* shard_policy(const struct shard* shard) {
+  return cache.policy_states[shard - cache.shards];
+}
+
+// A lock whose holder died is taken over as it is; what the holder left in
+// flight is cleaned up by peers_reap().
+static void mutex_lock(pthread_mutex_t* mutex) {
+  if (pthread_mutex_lock(mutex) == EOWNERDEAD) {
+    (void)pthread_mutex_consistent(mutex);
+  }
+}
+
+// Sleeps until the event fires or `timeout_ns` pass, with the mutex
+// dropped. Returns true on timeout.
+static bool event_sleep(
+    struct event* event, pthread_mutex_t* mutex, long timeout_ns
+) {
+  int err = errno;
+  atomic_fetch_add(&event->waiters, 1);
+  uint32_t seq = atomic_load(&event->seq);
+  (void)pthread_mutex_unlock(mutex);
+  struct timespec timeout = {
+      .tv_sec = timeout_ns / 1000000000L,
+      .tv_nsec = timeout_ns % 1000000000L,
+  };
+  long result = syscall(
+      SYS_futex,
+      &event->seq,
+      cache.shm ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE,
+      seq,
+      (timeout_ns > 0) ? &timeout : NULL,
+      NULL,
+      0
+  );
+  bool timed_out = result == -1 && errno == ETIMEDOUT;
+  atomic_fetch_sub(&event->waiters, 1);
+  errno = err;
+  return timed_out;
+}
+
+// In a shared segment the wakeup may be owed by a peer that died, so the
+// wait gives up now and then to clean up after dead peers.
+static void event_wait(struct event* event, pthread_mutex_t* mutex) {
+  if (event_sleep(event, mutex, cache.shm ? REAP_INTERVAL_NS : 0)) {
+    peers_reap();
+  }
+  mutex_lock(mutex);
+}
+
+static void event_wait_for(
+    struct event* event, pthread_mutex_t* mutex, long timeout_ns
+) {
+  (void)event_sleep(event, mutex, timeout_ns);
+  mutex_lock(mutex);
+}
+
+static void event_broadcast(struct event* event) {
+  atomic_fetch_add(&event->seq, 1);
+  if (atomic_load(&event->waiters) > 0) {
+    (void)syscall(
+        SYS_futex,
+        &event->seq,
+        cache.shm ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE,
+        INT_MAX,
+        NULL,
+        NULL,
+        0
+    );
+  }
+}
+
+static void mutex_setup(pthread_mutex_t* mutex) {
+  pthread_mutexattr_t attr;
+  (void)pthread_mutexattr_init(&attr);
+  if (cache.shm) {
+    (void)pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    (void)pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  }
+  (void)pthread_mutex_init(mutex, &attr);
+  (void)pthread_mutexattr_destroy(&attr);
+}
+
+static void event_setup(struct event* event) {
+  atomic_init(&event->seq, 0);
+  atomic_init(&event->waiters, 0);
+}
+
+// Carves the block pool and all metadata out of one arena. The metadata
+// is kept apart from the blocks, so that index and policy scans touch only
+// a few compact arrays. The layout depends on nothing but the capacity,
+// the shard count, the size of the compressed tier, the curve estimator
+// and the policy, so every process attached to a shared segment finds the
+// same pieces in it.
+static void cache_layout(struct vtpc_arena* arena) {
+  cache.shared = vtpc_arena_take(
+      arena, sizeof(struct shared), _Alignof(struct shared)
+  );
+  cache.files = vtpc_arena_take(
+      arena, VTPC_MAX_FILES * sizeof(struct file), _Alignof(struct file)
+  );
+  cache.peers = vtpc_arena_take(
+      arena, cache.peer_count * sizeof(struct peer), _Alignof(struct peer)
+  );
+  cache.paths =
+      cache.shm ? vtpc_arena_take(arena, VTPC_MAX_FILES * PATH_MAX, 1) : NULL;
+  cache.data = vtpc_arena_take(
+      arena, (size_t)cache.capacity * VTPC_BLOCK_SIZE, VTPC_BLOCK_SIZE
+  );
+  cache.frames = vtpc_arena_take(
+      arena, cache.capacity * sizeof(struct frame), _Alignof(struct frame)
+  );
+  cache.dirty_links = vtpc_arena_take(
+      arena,
+      cache.capacity * sizeof(struct vtpc_link),
+      _Alignof(struct vtpc_link)
+  );
+  cache.probation_links = vtpc_arena_take(
+      arena,
+      cache.capacity * sizeof(struct vtpc_link),
+      _Alignof(struct vtpc_link)
+  );
+  cache.shards = vtpc_arena_take(
+      arena, cache.shard_count * sizeof(struct shard), _Alignof(struct shard)
+  );
+  for (uint32_t i = 0; i < cache.shard_count; ++i) {
+    uint32_t size = shard_size(i);
+    cache.indexes[i] = vtpc_arena_take(
+        arena, vtpc_index_footprint(size), VTPC_INDEX_ALIGN
+    );
+    cache.policy_states[i] = vtpc_arena_take(
+        arena, cache.policy->footprint(size), _Alignof(uint64_t)
+    );
+  }
+  cache.zdata = vtpc_arena_take(
+      arena, (size_t)cache.zpool * VTPC_BLOCK_SIZE, _Alignof(struct zentry)
+  );
+  for (uint32_t i = 0; i < cache.shard_count && cache.zpool > 0; ++i) {
+    cache.zbuckets[i] = vtpc_arena_take(
+        arena,
+        zpool_buckets(zpool_share(i)) * sizeof(uint32_t),
+        _Alignof(uint32_t)
+    );
+  }
+  cache.mrc_state = NULL;
+  if (cache.mrc > 0) {
+    cache.mrc_state = vtpc_arena_take(
+        arena, vtpc_mrc_footprint(cache.mrc), VTPC_MRC_ALIGN
+    );
+  }
+}
+
+static void shard_setup(
+    struct shard* shard, uint32_t base, uint32_t size, uint32_t scan
+) {
+  mutex_setup(&shard->lock);
+  event_setup(&shard->io_done);
+  shard->base = base;
+  shard->capacity = size;
+  shard->limit = size;
+  vtpc_list_init(&shard->probation);
+  shard->probation_min = (uint32_t)(((uint64_t)size * scan + 99) / 100);
+  cache.policy->init(shard_policy(shard), size);
+
+  for (uint32_t i = base; i < base + size; ++i) {
+    cache.frames[i].file = -1;
+    cache.frames[i].next = (i + 1 < base + size) ? i + 1 : VTPC_NIL;
+  }
+  vtpc_index_init(shard_index(shard), size);
+  shard->free = base;
+}
+
+static void zpool_setup(struct shard* shard, uint32_t zbase, uint32_t units) {
+  shard->zbase = zbase;
+  shard->zsize = units;
+  if (units == 0) {
+    return;
+  }
+  shard->zmask = zpool_buckets(units) - 1;
+  for (uint32_t i = 0; i <= shard->zmask; ++i) {
+    cache.zbuckets[shard - cache.shards][i] = VTPC_NIL;
+  }
+}
+
+// Sets up a freshly mapped arena of `size` bytes, with `active` of its
+// frames in use.
+static void cache_format(
+    size_t size,
+    uint32_t active,
+    uint32_t background,
+    uint32_t limit,
+    uint32_t scan
+) {
+  struct shared* shared = cache.shared;
+  shared->size = size;
+  shared->capacity = cache.capacity;
+  shared->shard_count = cache.shard_count;
+  shared->zpool = cache.zpool;
+  shared->mrc = cache.mrc;
+  (void)snprintf(shared->policy, POLICY_NAME_MAX, "%s", cache.policy->name);
+  mutex_setup(&shared->files_lock);
+  event_setup(&shared->files_closed);
+  mutex_setup(&shared->peers_lock);
+  mutex_setup(&shared->flush_lock);
+  event_setup(&shared->flush_wake);
+  event_setup(&shared->flush_done);
+  mutex_setup(&shared->resize_lock);
+  mutex_setup(&shared->mrc_lock);
+  if (cache.mrc_state != NULL) {
+    vtpc_mrc_init(cache.mrc_state, cache.mrc, 2 * (uint64_t)cache.capacity);
+  }
+
+  uint32_t base = 0;
+  uint32_t zbase = 0;
+  for (uint32_t i = 0; i < cache.shard_count; ++i) {
+    shard_setup(&cache.shards[i], base, shard_size(i), scan);
+    zpool_setup(&cache.shards[i], zbase, zpool_share(i));
+    base += shard_size(i);
+    zbase += zpool_share(i);
+  }
+  for (int i = 0; i < VTPC_MAX_FILES; ++i) {
+    mutex_setup(&cache.files[i].lock);
+    event_setup(&cache.files[i].io_done);
+    event_setup(&cache.files[i].synced);
+    cache.files[i].sync_leader = -1;
+  }
+  for (uint32_t i = 0; i < cache.peer_count; ++i) {
+    mutex_setup(&cache.peers[i].life);
+  }
+
+  shared->background_ratio = background;
+  shared->limit_ratio = limit;
+  shared->scan_ratio = scan;
+  shared->target = active;
+  (void)cache_resize(active);
+}
+
+// Maps the shared segment `name`, setting it up unless another process has
+// done so already; the capacity, shards, compressed tier, curve estimator
+// and policy it was set up with then override those of this process.
+static int shm_map(
+    const char* name,
+    struct vtpc_arena* arena,
+    uint32_t active,
+    uint32_t background,
+    uint32_t limit,
+    uint32_t scan
+) {
+  int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+  if (fd == -1) {
+    return -1;
+  }
+  // Keeps the others out until the segment is set up. The kernel drops the
+  // lock should this process die first, and the next one starts over.
+  int result = 0;
+  while ((result = flock(fd, LOCK_EX)) == -1 && errno == EINTR) {
+  }
+
+  struct shared header;
+  memset(&header, 0, sizeof(header));
+  bool ready = result == 0 &&
+               pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+               header.magic == SHM_MAGIC;
+  if (ready) {
+    header.policy[POLICY_NAME_MAX - 1] = '\0';
+    cache.capacity = header.capacity;
+    cache.shard_count = header.shard_count;
+    cache.zpool = header.zpool;
+    cache.mrc = header.mrc;
+    cache.policy = vtpc_policy_find(header.policy);
+  }
+  if (ready && (cache.policy == NULL || cache.shard_count == 0 ||
+                cache.shard_count > cache.capacity ||
+                cache.shard_count > SHARDS_MAX)) {
+    errno = EINVAL;
+    result = -1;
+  }
+  if (result == 0) {
+    cache_layout(arena);
+  }
+  if (result == 0 && ready && arena->used != header.size) {
+    // Set up by an incompatible build.
+    errno = EINVAL;
+    result = -1;
+  }
+  if (result == 0 && !ready) {
+    result = ftruncate(fd, 0);
+  }
+  if (result == 0 && !ready) {
+    result = ftruncate(fd, (off_t)arena->used);
+  }
+  if (result == 0) {
+    result = vtpc_arena_map_fd(arena, fd, arena->used);
+  }
+  if (result == 0) {
+    cache_layout(arena);
+  }
+  if (result == 0 && !ready) {
+    cache_format(arena->used, active, background, limit, scan);
+    __atomic_store_n(&cache.shared->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+  }
+
+  // The mapping holds on to the file, and with it to the lock.
+  int err = errno;
+  (void)flock(fd, LOCK_UN);
+  (void)close(fd);
+  errno = err;
+  return result;
+}
+
+struct keeper_start {
+  pthread_mutex_t* life;
+  sem_t locked;
+};
+
+// Holds the life lock of this process until it exits, whichever way.
+static void* keeper_main(void* arg) {
+  struct keeper_start* start = arg;
+  mutex_lock(start->life);
+  (void)sem_post(&start->locked);
+  while (true) {
+    (void)pause();
+  }
+  return NULL;
+}
+
+static int keeper_spawn(pthread_mutex_t* life) {
+  struct keeper_start start = {.life = life};
+  (void)sem_init(&start.locked, 0, 0);
+  // The keeper must not take signals meant for the application.
+  sigset_t all;
+  sigset_t old;
+  (void)sigfillset(&all);
+  (void)pthread_sigmask(SIG_SETMASK, &all, &old);
+  pthread_t thread;
+  int result = pthread_create(&thread, NULL, keeper_main, &start);
+  (void)pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (result == 0) {
+    (void)pthread_detach(thread);
+    while (sem_wait(&start.locked) == -1) {
+    }
+  }
+  (void)sem_destroy(&start.locked);
+  errno = result;
+  return (result == 0) ? 0 : -1;
+}
+
+static void peers_reap_locked(void);
+
+// Takes a peer slot for this process.
+static int peer_join(void) {
+  if (!cache.shm) {
+    cache.peer = 0;
+    cache.peers[0].used = true;
+    cache.peers[0].pid = getpid();
+    return 0;
+  }
+
+  mutex_lock(&cache.shared->peers_lock);
+  peers_reap_locked();
+  uint32_t peer = 0;
+  while (peer < cache.peer_count && cache.peers[peer].used) {
+    ++peer;
+  }
+  int result = -1;
+  if (peer == cache.peer_count) {
+    errno = EUSERS;
+  } else {
+    result = keeper_spawn(&cache.peers[peer].life);
+  }
+  if (result == 0) {
+    cache.peers[peer].used = true;
+    cache.peers[peer].pid = getpid();
+    memset(cache.peers[peer].refs, 0, sizeof(cache.peers[peer].refs));
+    cache.peer = (int)peer;
+  }
+  (void)pthread_mutex_unlock(&cache.shared->peers_lock);
+  return result;
+}
+
+static int cache_setup(void) {
+  uint32_t capacity = 0;
+  uint32_t capacity_max = 0;
+  uint32_t shards = 0;
+  uint32_t huge = 0;
+  uint32_t background = 0;
+  uint32_t limit = 0;
+  uint32_t scan = 0;
+  uint32_t psi = 0;
+  uint32_t zpool = 0;
+  uint32_t mrc = 0;
+  uint32_t autosize = 0;
+  uint32_t sync_window = 0;
+  if (parse_env("VTPC_CAPACITY", VTPC_CAPACITY, VTPC_NIL - 1, &capacity) ==
+          -1 ||
+      parse_env("VTPC_CAPACITY_MAX", 0, VTPC_NIL - 1, &capacity_max) == -1 ||
+      parse_env("VTPC_SHARDS", 0, SHARDS_MAX, &shards) == -1 ||
+      parse_env("VTPC_HUGEPAGES", VTPC_HUGE_NONE, VTPC_HUGE_TLB, &huge) ==
+          -1 ||
+      parse_env("VTPC_DIRTY_BACKGROUND_RATIO", 0, 100, &background) == -1 ||
+      parse_env("VTPC_DIRTY_RATIO", 0, 100, &limit) == -1 ||
+      parse_env("VTPC_SCAN_RATIO", SCAN_RATIO_DEFAULT, 100, &scan) == -1 ||
+      parse_env("VTPC_PSI", 0, VTPC_PSI_WINDOW_US, &psi) == -1 ||
+      parse_env("VTPC_ZPOOL", 0, ZPOOL_MAX, &zpool) == -1 ||
+      parse_env("VTPC_MRC", 0, 1, &mrc) == -1 ||
+      parse_env("VTPC_AUTOSIZE", 0, VTPC_NIL - 1, &autosize) == -1 ||
+      parse_env("VTPC_SYNC_WINDOW", 0, SYNC_WINDOW_MAX_US, &sync_window) ==
+          -1 ||
+      capacity == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (shards == 0) {
+    shards = default_shards(capacity);
+  }
+  if (shards > capacity) {
+    shards = capacity;
+  }
+  const struct vtpc_policy* policy = vtpc_policy_find(getenv("VTPC_POLICY"));
+  if (policy == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+  for (int i = 0; i < VTPC_MAX_FILES; ++i) {
+    fds[i].fd = -1;
+  }
+
+  const char* suffix = getenv("VTPC_MANIFEST");
+  manifest_suffix = (suffix != NULL && *suffix != '\0') ? suffix : NULL;
+  const char* name = getenv("VTPC_SHM");
+  cache.shm = name != NULL && *name != '\0';
+  cache.peer_count = cache.shm ? PEERS_MAX : 1;
+  cache.peer = -1;
+  // Frames up to the maximum are laid out, but only touched once in use.
+  cache.capacity = (capacity_max > capacity) ? capacity_max : capacity;
+  cache.shard_count = shards;
+  cache.zpool = zpool;
+  cache.mrc = (mrc > 0 || autosize > 0) ? MRC_SAMPLES : 0;
+  cache.sync_window_ns = (long)sync_window * 1000L;
+  cache.policy = policy;
+  struct vtpc_arena arena = {0};
+  if (cache.shm) {
+    if (shm_map(name, &arena, capacity, background, limit, scan) == -1) {
+      return -1;
+    }
+  } else {
+    cache_layout(&arena);
+    if (vtpc_arena_map(&arena, arena.used, (int)huge) == -1) {
+      return -1;
+    }
+    cache_layout(&arena);
+    cache_format(arena.used, capacity, background, limit, scan);
+  }
+  if (peer_join() == -1) {
+    return -1;
+  }
+
+  if (background > 0) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, flusher_main, NULL) == 0) {
+      (void)pthread_detach(thread);
+      cache.flusher = true;
+    }
+  }
+  if (psi > 0) {
+    // Stays off where the kernel does not track pressure.
+    (void)vtpc_psi_start(psi);
+  }
+  if (autosize > 0 && cache.mrc_state != NULL) {
+    (void)vtpc_autosize_start(
+        (autosize < cache.capacity) ? autosize : cache.capacity
+    );
+  }
+  if (manifest_suffix != NULL) {
+    (void)atexit(manifests_save);
+  }
+  return 0;
+}
+
+static void cache_init_once(void) {
+  if (cache_setup() == -1) {
+    init_errno = errno;
+  }
+}
+
+static int cache_init(void) {
+  (void)pthread_once(&init_once, cache_init_once);
+  if (init_errno != 0) {
+    errno = init_errno;
+    return -1;
+  }
+  return 0;
+}
+
+static char* frame_data(uint32_t idx) {
+  return cache.data + ((size_t)idx * VTPC_BLOCK_SIZE);
+}
+
+static uint64_t key_of(int file, off_t block) {
+  return ((uint64_t)file << KEY_FILE_SHIFT) | (uint64_t)block;
+}
+
+static uint32_t hash_of(uint64_t key) {
+  return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32U);
+}
+
+static struct shard* shard_of(int file, off_t block) {
+  uint32_t hash = hash_of(key_of(file, block >> EXTENT_SHIFT));
+  return &cache.shards[hash % cache.shard_count];
+}
+
+static uint32_t index_lookup(struct shard* shard, int file, off_t block) {
+  return vtpc_index_find(shard_index(shard), key_of(file, block));
+}
+
+// Looks `block` up without the shard lock, so that a hit only holds the
+// lock for index_confirm(). The answer may be stale by then.
+static uint32_t index_guess(int file, off_t block) {
+  const struct shard* shard = shard_of(file, block);
+  return vtpc_index_find_unlocked(shard_index(shard), key_of(file, block));
+}
+
+// Returns `guess` if its frame holds `block`, which the shard lock makes
+// certain as a frame holds a block exactly while it is indexed, else
+// looks the block up under the lock.
+static uint32_t index_confirm(
+    struct shard* shard, uint32_t guess, int file, off_t block
+) {
+  if (guess != VTPC_NIL && cache.frames[guess].file == file &&
+      cache.frames[guess].block == block) {
+    return guess;
+  }
+  return index_lookup(shard, file, block);
+}
+
+// Whether `block` is cached or being loaded, as seen without the shard
+// lock; good for skipping the lock where a wrong answer costs little.
+static bool index_peek(int file, off_t block) {
+  return index_guess(file, block) != VTPC_NIL;
+}
+
+static void index_insert(struct shard* shard, uint32_t idx) {
+  const struct frame* frame = &cache.frames[idx];
+  vtpc_index_insert(shard_index(shard), key_of(frame->file, frame->block), idx);
+}
+
+static void index_remove(struct shard* shard, uint32_t idx) {
+  const struct frame* frame = &cache.frames[idx];
+  vtpc_index_erase(shard_index(shard), key_of(frame->file, frame->block));
+}
+
+// Gives the memory of an offline frame back to the system. Fails harmlessly
+// on huge pages, which are only given back whole.
+static void frame_offline(uint32_t idx) {
+  (void)madvise(
+      frame_data(idx),
+      VTPC_BLOCK_SIZE,
+      cache.shm ? MADV_REMOVE : MADV_DONTNEED
+  );
+}
+
+// Frames past the limit of the shard go offline instead of to the free list.
+static void frame_free(struct shard* shard, uint32_t idx) {
+  cache.frames[idx].file = -1;
+  if (idx - shard->base >= shard->limit) {
+    frame_offline(idx);
+    return;
+  }
+  cache.frames[idx].next = shard->free;
+  shard->free = idx;
+}
+
+// Counts an event of `file` in a shard it holds the lock of.
+static void stat_add(struct shard* shard, int file, enum stat_id stat) {
+  ++shard->stats[stat];
+  (void)__atomic_fetch_add(&cache.files[file].stats[stat], 1, __ATOMIC_RELAXED);
+}
+
+static void flush_signal(struct event* event) {
+  mutex_lock(&cache.shared->flush_lock);
+  event_broadcast(event);
+  (void)pthread_mutex_unlock(&cache.shared->flush_lock);
+}
+
+static void frame_dirty(uint32_t idx) {
+  struct frame* frame = &cache.frames[idx];
+  if (frame->dirty) {
+    return;
+  }
+  frame->dirty = true;
+  struct file* file = &cache.files[frame->file];
+  mutex_lock(&file->lock);
+  vtpc_list_push_back(&file->dirty, cache.dirty_links, idx);
+  (void)pthread_mutex_unlock(&file->lock);
+  if (atomic_fetch_add(&cache.shared->dirty, 1) ==
+          cache.shared->dirty_background &&
+      (cache.flusher || cache.shm)) {
+    flush_signal(&cache.shared->flush_wake);
+  }
+}
+
+// With `writeback` the frame is handed over to a write that runs without
+// the shard lock.
+static void frame_clean(uint32_t idx, bool writeback) {
+  struct frame* frame = &cache.frames[idx];
+  if (!frame->dirty) {
+    return;
+  }
+  frame->dirty = false;
+  frame->writeback = writeback;
+  frame->owner = cache.peer;
+  struct file* file = &cache.files[frame->file];
+  mutex_lock(&file->lock);
+  vtpc_list_unlink(&file->dirty, cache.dirty_links, idx);
+  file->writeback += writeback ? 1 : 0;
+  (void)pthread_mutex_unlock(&file->lock);
+  (void)atomic_fetch_sub(&cache.shared->dirty, 1);
+}
+
+static bool frame_busy(const struct frame* frame) {
+  return frame->loading || frame->writeback;
+}
+
+static bool frame_evictable(uint32_t local, void* arg) {
+  const struct shard* shard = arg;
+  const struct frame* frame = &cache.frames[shard->base + local];
+  return !frame_busy(frame) && frame->pins == 0;
+}
+
+static bool frame_flushable(uint32_t idx) {
+  return idx != VTPC_NIL && cache.frames[idx].dirty &&
+         !frame_busy(&cache.frames[idx]);
+}
+
+// A clock that is cheap to read and agrees across shards and processes,
+// good enough to rank blocks by recency for a manifest.
+static uint64_t touch_time(void) {
+  struct timespec now;
+  (void)clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+}
+
+static struct vtpc_link* probation_links(const struct shard* shard) {
+  return cache.probation_links + shard->base;
+}
+
+// Hands a loaded frame to the policy, or to the probation list if `cold`.
+static void frame_admit(struct shard* shard, uint32_t idx, bool cold) {
+  struct frame* frame = &cache.frames[idx];
+  frame->touched = touch_time();
+  frame->cold = cold && shard->probation_min > 0;
+  if (frame->cold) {
+    vtpc_list_push_front(
+        &shard->probation, probation_links(shard), idx - shard->base
+    );
+  } else {
+    cache.policy->insert(
+        shard_policy(shard),
+        idx - shard->base,
+        key_of(frame->file, frame->block)
+    );
+  }
+}
+
+static void frame_forget(struct shard* shard, uint32_t idx) {
+  if (cache.frames[idx].cold) {
+    vtpc_list_unlink(
+        &shard->probation, probation_links(shard), idx - shard->base
+    );
+    cache.frames[idx].cold = false;
+  } else {
+    cache.policy->remove(shard_policy(shard), idx - shard->base);
+  }
+}
+
+static void frame_release(struct shard* shard, uint32_t idx) {
+  if (cache.frames[idx].prefetched) {
+    stat_add(shard, cache.frames[idx].file, STAT_READAHEAD_WASTED);
+  }
+  frame_clean(idx, false);
+  index_remove(shard, idx);
+  frame_forget(shard, idx);
+  frame_free(shard, idx);
+}
+
+static int open_direct(const char* path, int flags, mode_t mode) {
+  int fd = open(path, flags | O_DIRECT, mode);
+  if (fd == -1 && errno == EINVAL) {
+    // The filesystem does not support O_DIRECT (e.g. tmpfs).
+    fd = open(path, flags, mode);
+  }
+  return fd;
+}
+
+// Opens `path` read-write, or read-only if `fallback` allows it and the file
+// or its filesystem does not let it be written; `read_only` tells which.
+static int open_backing(
+    const char* path, int flags, mode_t mode, bool fallback, bool* read_only
+) {
+  *read_only = false;
+  int fd = open_direct(path, flags | O_RDWR, mode);
+  if (fd == -1 && fallback && (errno == EACCES || errno == EROFS)) {
+    fd = open_direct(path, flags | O_RDONLY, mode);
+    *read_only = (fd != -1);
+  }
+  return fd;
+}
+
+// Returns the descriptor of this process for `file`. Files opened by other
+// processes only are opened here by path when their blocks need writing.
+static int file_fd(int file) {
+  const struct file* f = &cache.files[file];
+  uint32_t generation = __atomic_load_n(&f->generation, __ATOMIC_ACQUIRE);
+  (void)pthread_mutex_lock(&fds_lock);
+  if (fds[file].fd != -1 && fds[file].generation != generation) {
+    (void)close(fds[file].fd);
+    fds[file].fd = -1;
+  }
+  if (fds[file].fd == -1 && cache.paths != NULL) {
+    bool read_only = false;
+    int fd = open_backing(cache.paths[file], O_CLOEXEC, 0, true, &read_only);
+    struct stat st;
+    if (fd != -1 && (fstat(fd, &st) == -1 || st.st_dev != f->dev ||
+                     st.st_ino != f->ino)) {
+      (void)close(fd);
+      fd = -1;
+      errno = ESTALE;
+    }
+    fds[file].fd = fd;
+    fds[file].generation = generation;
+    fds[file].read_only = read_only;
+  }
+  int fd = fds[file].fd;
+  (void)pthread_mutex_unlock(&fds_lock);
+  if (fd == -1 && cache.paths == NULL) {
+    errno = EBADF;
+  }
+  return fd;
+}
+
+static void disk_grow(struct file* file, off_t end) {
+  mutex_lock(&file->lock);
+  if (end > file->disk_size) {
+    file->disk_size = end;
+  }
+  (void)pthread_mutex_unlock(&file->lock);
+}
+
+static void iov_fill(struct iovec* iov, const uint32_t* run, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    iov[i].iov_base = frame_data(run[i]);
+    iov[i].iov_len = VTPC_BLOCK_SIZE;
+  }
+}
+
+// Reads the first `size` bytes of `block` from the disk into `to`. What
+// lies past the end of the disk reads as zeros.
+static int block_read_start(int file, off_t block, char* to, size_t size) {
+  // O_DIRECT reads whole blocks into aligned memory only.
+  char* buffer = aligned_alloc(VTPC_BLOCK_SIZE, VTPC_BLOCK_SIZE);
+  if (buffer == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+  struct iovec iov = {buffer, VTPC_BLOCK_SIZE};
+  off_t offset = block * VTPC_BLOCK_SIZE;
+  struct vtpc_io io = {file_fd(file), false, &iov, 1, offset, 0, 0};
+  if (io.fd == -1) {
+    io.result = -1;
+    io.error = errno;
+  } else {
+    vtpc_io_run(&io, 1);
+  }
+  if (io.result != -1) {
+    size_t have = ((size_t)io.result < size) ? (size_t)io.result : size;
+    memcpy(to, buffer, have);
+    memset(to + have, 0, size - have);
+  }
+  free(buffer);
+  if (io.result == -1) {
+    errno = io.error;
+    return -1;
+  }
+  return 0;
+}
+
+// Completes a frame that a write took without reading the disk, once
+// a reader or a writeback needs the bytes before `valid`. The shard lock is
+// dropped meanwhile, with the frame marked loading so that nobody else
+// touches it.
+static int frame_fill(struct shard* shard, uint32_t idx) {
+  struct frame* frame = &cache.frames[idx];
+  frame->loading = true;
+  frame->owner = cache.peer;
+  ++shard->loading;
+  (void)pthread_mutex_unlock(&shard->lock);
+  int result = block_read_start(
+      frame->file, frame->block, frame_data(idx), frame->valid
+  );
+  mutex_lock(&shard->lock);
+  frame->loading = false;
+  --shard->loading;
+  if (result == 0) {
+    frame->valid = 0;
+  }
+  event_broadcast(&shard->io_done);
+  return result;
+}
+
+// Writes back a dirty victim together with the dirty blocks around it that
+// belong to the same shard, whose lock is held throughout.
+static int write_cluster(struct shard* shard, uint32_t idx) {
+  const struct frame* frame = &cache.frames[idx];
+  int file = frame->file;
+  off_t lo = frame->block;
+  off_t hi = frame->block;
+  while (lo > 0 && hi - lo + 1 < RUN_MAX && shard_of(file, lo - 1) == shard &&
+         frame_flushable(index_lookup(shard, file, lo - 1))) {
+    --lo;
+  }
+  while (hi - lo + 1 < RUN_MAX && shard_of(file, hi + 1) == shard &&
+         frame_flushable(index_lookup(shard, file, hi + 1))) {
+    ++hi;
+  }
+
+  uint32_t run[RUN_MAX];
+  uint32_t count = 0;
+  for (off_t block = lo; block <= hi; ++block) {
+    run[count++] = (block == frame->block) ? idx
+                                           : index_lookup(shard, file, block);
+  }
+  int fd = file_fd(file);
+  if (fd == -1) {
+    return -1;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    struct frame* part = &cache.frames[run[i]];
+    if (part->valid > 0) {
+      if (block_read_start(file, lo + i, frame_data(run[i]), part->valid) ==
+          -1) {
+        return -1;
+      }
+      part->valid = 0;
+    }
+  }
+  struct iovec iov[RUN_MAX];
+  iov_fill(iov, run, count);
+  off_t offset = lo * VTPC_BLOCK_SIZE;
+  struct vtpc_io io = {fd, true, iov, (int)count, offset, 0, 0};
+  vtpc_io_run(&io, 1);
+  if (io.result == -1) {
+    errno = io.error;
+    return -1;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    frame_clean(run[i], false);
+    stat_add(shard, file, STAT_WRITEBACKS);
+  }
+  disk_grow(&cache.files[file], offset + ((off_t)count * VTPC_BLOCK_SIZE));
+  flush_signal(&cache.shared->flush_done);
+  return 0;
+}
+
+static struct zentry* zentry_at(const struct shard* shard, uint32_t unit) {
+  return (struct zentry*)(cache.zdata +
+                          ((size_t)(shard->zbase + unit) * ZPOOL_UNIT));
+}
+
+static uint32_t* zbucket_of(const struct shard* shard, uint64_t key) {
+  return &cache.zbuckets[shard - cache.shards][hash_of(key) & shard->zmask];
+}
+
+static uint32_t zpool_find(const struct shard* shard, uint64_t key) {
+  if (shard->zsize == 0) {
+    return VTPC_NIL;
+  }
+  uint32_t unit = *zbucket_of(shard, key);
+  while (unit != VTPC_NIL && zentry_at(shard, unit)->key != key) {
+    unit = zentry_at(shard, unit)->next;
+  }
+  return unit;
+}
+
+// Takes the entry at `unit` out of its chain. Its units stay taken until
+// the tail of the ring passes them.
+static void zpool_unlink(struct shard* shard, uint32_t unit) {
+  struct zentry* entry = zentry_at(shard, unit);
+  uint32_t* link = zbucket_of(shard, entry->key);
+  while (*link != unit) {
+    link = &zentry_at(shard, *link)->next;
+  }
+  *link = entry->next;
+  entry->size = 0;
+}
+
+static void zpool_remove(struct shard* shard, uint64_t key) {
+  uint32_t unit = zpool_find(shard, key);
+  if (unit != VTPC_NIL) {
+    zpool_unlink(shard, unit);
+  }
+}
+
+// Drops the entries of `file`.
+static void zpool_forget(struct shard* shard, int file) {
+  for (uint32_t i = 0; shard->zsize > 0 && i <= shard->zmask; ++i) {
+    uint32_t* link = &cache.zbuckets[shard - cache.shards][i];
+    while (*link != VTPC_NIL) {
+      struct zentry* entry = zentry_at(shard, *link);
+      if (entry->key >> KEY_FILE_SHIFT == (uint64_t)file) {
+        *link = entry->next;
+        entry->size = 0;
+      } else {
+        link = &entry->next;
+      }
+    }
+  }
+}
+
+// Drops the oldest entries until `span` units from `unit` on are free.
+static void zpool_clear(struct shard* shard, uint32_t unit, uint32_t span) {
+  while (shard->zused > 0 && shard->ztail >= unit &&
+         shard->ztail < unit + span) {
+    struct zentry* entry = zentry_at(shard, shard->ztail);
+    if (entry->size > 0) {
+      zpool_unlink(shard, shard->ztail);
+    }
+    shard->zused -= entry->span;
+    shard->ztail += entry->span;
+    if (shard->ztail == shard->zsize) {
+      shard->ztail = 0;
+    }
+  }
+}
+
+// Makes room for an entry of `span` units at the head of the ring and
+// returns where it starts.
+static uint32_t zpool_reserve(struct shard* shard, uint32_t span) {
+  if (shard->zhead + span > shard->zsize) {
+    // Entries do not wrap around: pad the rest of the ring.
+    uint32_t rest = shard->zsize - shard->zhead;
+    zpool_clear(shard, shard->zhead, rest);
+    struct zentry* pad = zentry_at(shard, shard->zhead);
+    pad->size = 0;
+    pad->span = (uint16_t)rest;
+    shard->zused += rest;
+    shard->zhead = 0;
+  }
+  zpool_clear(shard, shard->zhead, span);
+  uint32_t unit = shard->zhead;
+  shard->zused += span;
+  shard->zhead += span;
+  if (shard->zhead == shard->zsize) {
+    shard->zhead = 0;
+  }
+  return unit;
+}
+
+// Keeps a compressed copy of the clean block in the frame `idx`, which is
+// about to be evicted.
+static void zpool_store(struct shard* shard, uint32_t idx) {
+  const struct frame* frame = &cache.frames[idx];
+  uint8_t packed[ZPOOL_ENTRY_MAX];
+  size_t size = vtpc_lz_compress(
+      (const uint8_t*)frame_data(idx), VTPC_BLOCK_SIZE, packed, sizeof(packed)
+  );
+  uint32_t span =
+      (uint32_t)((sizeof(struct zentry) + size + ZPOOL_UNIT - 1) / ZPOOL_UNIT);
+  if (size == 0 || span > shard->zsize) {
+    return;
+  }
+  uint32_t unit = zpool_reserve(shard, span);
+  struct zentry* entry = zentry_at(shard, unit);
+  entry->key = key_of(frame->file, frame->block);
+  entry->size = (uint16_t)size;
+  entry->span = (uint16_t)span;
+  memcpy(entry + 1, packed, size);
+  uint32_t* head = zbucket_of(shard, entry->key);
+  entry->next = *head;
+  *head = unit;
+  stat_add(shard, frame->file, STAT_COMPRESSED);
+}
+
+// Picks the frame to evict for `key`: the oldest block on probation once
+// scans hold their share of the shard, else the policy's choice. The victim
+// keeps its `cold` mark, in case it has to be admitted back.
+static uint32_t victim_pick(struct shard* shard, uint64_t key) {
+  struct vtpc_list* probation = &shard->probation;
+  uint32_t local = VTPC_NIL;
+  if (shard->probation_min > 0 && probation->size >= shard->probation_min) {
+    local = vtpc_policy_pop(
+        probation, probation_links(shard), frame_evictable, shard
+    );
+  }
+  if (local == VTPC_NIL) {
+    local = cache.policy->evict(
+        shard_policy(shard), key, frame_evictable, shard
+    );
+  }
+  if (local == VTPC_NIL) {
+    local = vtpc_policy_pop(
+        probation, probation_links(shard), frame_evictable, shard
+    );
+  }
+  return local;
+}
+
+// Takes a frame for `block` from the free list or by evicting one. Fails
+// with EAGAIN while every frame of the shard is busy with I/O, and with
+// ENOBUFS when they are all pinned.
+static uint32_t frame_alloc(struct shard* shard, int file, off_t block) {
+  while (shard->free == VTPC_NIL) {
+    uint32_t local = victim_pick(shard, key_of(file, block));
+    if (local == VTPC_NIL) {
+      errno = (shard->pinned >= shard->limit) ? ENOBUFS : EAGAIN;
+      return VTPC_NIL;
+    }
+    uint32_t victim = shard->base + local;
+    const struct frame* frame = &cache.frames[victim];
+    if (frame->dirty && write_cluster(shard, victim) == -1) {
+      frame_admit(shard, victim, frame->cold);
+      return VTPC_NIL;
+    }
+    stat_add(shard, frame->file, STAT_EVICTIONS);
+    if (frame->prefetched) {
+      stat_add(shard, frame->file, STAT_READAHEAD_WASTED);
+    } else if (!frame->cold && shard->zsize > 0) {
+      // Blocks of scans and readahead nobody wanted are not worth keeping.
+      zpool_store(shard, victim);
+    }
+    index_remove(shard, victim);
+    frame_free(shard, victim);
+  }
+  zpool_remove(shard, key_of(file, block));
+
+  uint32_t idx = shard->free;
+  shard->free = cache.frames[idx].next;
+  cache.frames[idx].file = file;
+  cache.frames[idx].block = block;
+  cache.frames[idx].prefetched = false;
+  cache.frames[idx].cold = false;
+  cache.frames[idx].valid = 0;
+  return idx;
+}
+
+// Allocates a frame for `block` and publishes it as loading, so that other
+// threads wait for it instead of reading the block again.
+static uint32_t frame_start_load(struct shard* shard, int file, off_t block) {
+  uint32_t idx = frame_alloc(shard, file, block);
+  if (idx != VTPC_NIL) {
+    cache.frames[idx].loading = true;
+    cache.frames[idx].owner = cache.peer;
+    ++shard->loading;
+    index_insert(shard, idx);
+  }
+  return idx;
+}
+
+// Moves `block` from the compressed tier into a frame, admitted like
+// a block just read. Returns VTPC_NIL if the tier does not hold the block
+// or no frame is to be had right away.
+static uint32_t zpool_load(
+    struct shard* shard, int file, off_t block, bool cold
+) {
+  uint32_t unit = zpool_find(shard, key_of(file, block));
+  if (unit == VTPC_NIL) {
+    return VTPC_NIL;
+  }
+  // Taking a frame may store its victim over the entry.
+  const struct zentry* entry = zentry_at(shard, unit);
+  uint8_t packed[ZPOOL_ENTRY_MAX];
+  size_t size = entry->size;
+  memcpy(packed, entry + 1, size);
+  zpool_unlink(shard, unit);
+
+  uint32_t idx = frame_alloc(shard, file, block);
+  if (idx == VTPC_NIL) {
+    return VTPC_NIL;
+  }
+  if (vtpc_lz_decompress(
+          packed, size, (uint8_t*)frame_data(idx), VTPC_BLOCK_SIZE
+      ) == -1) {
+    frame_free(shard, idx);
+    return VTPC_NIL;
+  }
+  index_insert(shard, idx);
+  frame_admit(shard, idx, cold);
+  return idx;
+}
+
+static void frame_end_load(uint32_t idx, bool loaded, bool cold) {
+  struct frame* frame = &cache.frames[idx];
+  struct shard* shard = shard_of(frame->file, frame->block);
+  mutex_lock(&shard->lock);
+  frame->loading = false;
+  --shard->loading;
+  if (loaded) {
+    frame_admit(shard, idx, cold);
+  } else {
+    index_remove(shard, idx);
+    frame_free(shard, idx);
+  }
+  event_broadcast(&shard->io_done);
+  (void)pthread_mutex_unlock(&shard->lock);
+}
+
+// Loads `block` into the loading frame `first` together with up to
+// `want - 1` following blocks that are not resident yet, using a single
+// read. Readahead frames are only taken where that does not have to wait.
+// The blocks of a `scan` go on probation. Returns the number of blocks
+// loaded, or -1.
+static int fill_run(
+    int file,
+    off_t block,
+    uint32_t first,
+    uint32_t need,
+    uint32_t want,
+    bool scan
+) {
+  struct file* f = &cache.files[file];
+  mutex_lock(&f->lock);
+  off_t disk_blocks = (f->disk_size + VTPC_BLOCK_SIZE - 1) / VTPC_BLOCK_SIZE;
+  (void)pthread_mutex_unlock(&f->lock);
+  if (want > RUN_MAX) {
+    want = RUN_MAX;
+  }
+
+  uint32_t run[RUN_MAX];
+  run[0] = first;
+  uint32_t count = 1;
+  while (count < want && block + count < disk_blocks &&
+         !index_peek(file, block + count)) {
+    struct shard* shard = shard_of(file, block + count);
+    uint32_t idx = VTPC_NIL;
+    mutex_lock(&shard->lock);
+    if (shard->loading < shard->limit / 2 &&
+        index_lookup(shard, file, block + count) == VTPC_NIL) {
+      idx = frame_start_load(shard, file, block + count);
+    }
+    if (idx != VTPC_NIL && count >= need) {
+      cache.frames[idx].prefetched = true;
+      stat_add(shard, file, STAT_READAHEAD);
+    }
+    (void)pthread_mutex_unlock(&shard->lock);
+    if (idx == VTPC_NIL) {
+      break;
+    }
+    run[count++] = idx;
+  }
+
+  struct iovec iov[RUN_MAX];
+  iov_fill(iov, run, count);
+  off_t offset = block * VTPC_BLOCK_SIZE;
+  struct vtpc_io io = {file_fd(file), false, iov, (int)count, offset, 0, 0};
+  if (io.fd == -1) {
+    io.result = -1;
+    io.error = errno;
+  } else if (block < disk_blocks) {
+    vtpc_io_run(&io, 1);
+  }
+  ssize_t done = io.result;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    size_t have = 0;
+    if (done > 0 && (size_t)done > (size_t)i * VTPC_BLOCK_SIZE) {
+      have = (size_t)done - ((size_t)i * VTPC_BLOCK_SIZE);
+      have = (have < VTPC_BLOCK_SIZE) ? have : VTPC_BLOCK_SIZE;
+    }
+    memset(frame_data(run[i]) + have, 0, VTPC_BLOCK_SIZE - have);
+    frame_end_load(run[i], done != -1, scan);
+  }
+  if (done == -1) {
+    errno = io.error;
+    return -1;
+  }
+  return (int)count;
+}
+
+// Bytes of `block` that lie within the file.
+static uint32_t block_eof(int file, off_t block) {
+  struct file* f = &cache.files[file];
+  mutex_lock(&f->lock);
+  off_t size = f->size - (block * VTPC_BLOCK_SIZE);
+  (void)pthread_mutex_unlock(&f->lock);
+  if (size <= 0) {
+    return 0;
+  }
+  return (size < VTPC_BLOCK_SIZE) ? (uint32_t)size : VTPC_BLOCK_SIZE;
+}
+
+// Takes a frame for a write from `in` on into `block`, of which the file
+// holds `eof` bytes, without reading the disk. What the write leaves of
+// those is left for frame_fill().
+static uint32_t frame_blank(
+    struct shard* shard, int file, off_t block, uint32_t in, uint32_t eof
+) {
+  uint32_t idx = frame_alloc(shard, file, block);
+  if (idx != VTPC_NIL) {
+    memset(frame_data(idx), 0, VTPC_BLOCK_SIZE);
+    cache.frames[idx].valid = (in < eof) ? in : eof;
+    index_insert(shard, idx);
+    frame_admit(shard, idx, false);
+  }
+  return idx;
+}
+
+// Feeds the estimator of the miss-ratio curve, if any, with an access.
+static void mrc_access(int file, off_t block) {
+  uint64_t key = key_of(file, block);
+  if (cache.mrc_state == NULL || !vtpc_mrc_sampled(cache.mrc_state, key)) {
+    return;
+  }
+  mutex_lock(&cache.shared->mrc_lock);
+  vtpc_mrc_access(cache.mrc_state, key);
+  (void)pthread_mutex_unlock(&cache.shared->mrc_lock);
+}
+
+// Finds or loads `block` and returns its frame with the shard still locked.
+// The frame holds the bytes from `in` on, or for a write of the bytes up to
+// `end`, those the write does not replace; reads pass 0 for `end`.
+static struct shard* block_get(
+    int file,
+    off_t block,
+    uint32_t need,
+    uint32_t want,
+    bool scan,
+    uint32_t in,
+    uint32_t end,
+    uint32_t* out
+) {
+  struct shard* shard = shard_of(file, block);
+  bool missed = false;
+  mrc_access(file, block);
+  uint32_t guess = index_guess(file, block);
+  mutex_lock(&shard->lock);
+  while (true) {
+    uint32_t idx = index_confirm(shard, guess, file, block);
+    if (idx != VTPC_NIL && !cache.frames[idx].loading &&
+        cache.frames[idx].valid > ((end > 0) ? end : in)) {
+      if (!missed) {
+        stat_add(shard, file, STAT_MISSES);
+        missed = true;
+      }
+      if (frame_fill(shard, idx) == -1) {
+        (void)pthread_mutex_unlock(&shard->lock);
+        return NULL;
+      }
+      continue;
+    }
+    if (idx != VTPC_NIL && !cache.frames[idx].loading) {
+      struct frame* frame = &cache.frames[idx];
+      frame->touched = touch_time();
+      if (!frame->cold) {
+        cache.policy->hit(shard_policy(shard), idx - shard->base);
+      } else if (!scan) {
+        frame_forget(shard, idx);
+        frame_admit(shard, idx, false);
+      }
+      if (!missed) {
+        stat_add(shard, file, STAT_HITS);
+      }
+      if (frame->prefetched) {
+        frame->prefetched = false;
+        stat_add(shard, file, STAT_READAHEAD_HITS);
+      }
+      *out = idx;
+      return shard;
+    }
+    if (idx == VTPC_NIL) {
+      idx = zpool_load(shard, file, block, scan);
+      if (idx != VTPC_NIL && !missed) {
+        stat_add(shard, file, STAT_HITS);
+        stat_add(shard, file, STAT_COMPRESSED_HITS);
+      }
+      if (idx != VTPC_NIL) {
+        *out = idx;
+        return shard;
+      }
+    }
+    uint32_t eof = (idx == VTPC_NIL && end > 0) ? block_eof(file, block) : 0;
+    if (idx == VTPC_NIL && end > 0 && end >= eof) {
+      // The write leaves nothing to read but what precedes it.
+      idx = frame_blank(shard, file, block, in, eof);
+      if (idx != VTPC_NIL) {
+        *out = idx;
+        return shard;
+      }
+    } else if (idx == VTPC_NIL) {
+      idx = frame_start_load(shard, file, block);
+      if (idx != VTPC_NIL && !missed) {
+        stat_add(shard, file, STAT_MISSES);
+        missed = true;
+      }
+    } else {
+      // Someone else is loading it.
+      idx = VTPC_NIL;
+      errno = EAGAIN;
+    }
+    if (idx == VTPC_NIL && errno == EAGAIN) {
+      event_wait(&shard->io_done, &shard->lock);
+      continue;
+    }
+    if (idx == VTPC_NIL) {
+      (void)pthread_mutex_unlock(&shard->lock);
+      return NULL;
+    }
+
+    (void)pthread_mutex_unlock(&shard->lock);
+    int result = fill_run(file, block, idx, need, want, scan);
+    mutex_lock(&shard->lock);
+    if (result == -1) {
+      (void)pthread_mutex_unlock(&shard->lock);
+      return NULL;
+    }
+    // The frame may have been evicted again before the lock was retaken,
+    // in which case the lookup starts over.
+  }
+}
+
+static void wait_writeback(struct file* file) {
+  mutex_lock(&file->lock);
+  while (file->writeback > 0) {
+    event_wait(&file->io_done, &file->lock);
+  }
+  (void)pthread_mutex_unlock(&file->lock);
+}
+
+// Runs of frames handed over by frame_clean, written back together with
+// one request per run and without holding any lock.
+struct flush_batch {
+  int file;
+  int runs;
+  uint32_t frames;
+  off_t first[VTPC_IO_DEPTH];     // first block of each run
+  uint32_t start[VTPC_IO_DEPTH];  // first entry of each run in `run`
+  uint32_t run[RUN_MAX];
+  struct iovec iov[RUN_MAX];
+  struct vtpc_io ios[VTPC_IO_DEPTH];
+  int error;  // first error seen, 0 if none
+};
+
+static void batch_write(struct flush_batch* batch) {
+  if (batch->runs == 0) {
+    return;
+  }
+  struct file* f = &cache.files[batch->file];
+  int fd = file_fd(batch->file);
+  iov_fill(batch->iov, batch->run, batch->frames);
+  for (int r = 0; r < batch->runs; ++r) {
+    uint32_t end = (r + 1 < batch->runs) ? batch->start[r + 1] : batch->frames;
+    batch->ios[r] = (struct vtpc_io){
+        .fd = fd,
+        .write = true,
+        .iov = &batch->iov[batch->start[r]],
+        .count = (int)(end - batch->start[r]),
+        .offset = batch->first[r] * VTPC_BLOCK_SIZE,
+        .result = (fd == -1) ? -1 : 0,
+        .error = (fd == -1) ? errno : 0,
+    };
+  }
+  if (fd != -1) {
+    vtpc_io_run(batch->ios, batch->runs);
+  }
+
+  off_t disk_end = 0;
+  for (int r = 0; r < batch->runs; ++r) {
+    uint32_t end = (r + 1 < batch->runs) ? batch->start[r + 1] : batch->frames;
+    bool failed = batch->ios[r].result == -1;
+    for (uint32_t i = batch->start[r]; i < end; ++i) {
+      off_t block = batch->first[r] + (off_t)(i - batch->start[r]);
+      struct shard* shard = shard_of(batch->file, block);
+      mutex_lock(&shard->lock);
+      cache.frames[batch->run[i]].writeback = false;
+      if (failed) {
+        frame_dirty(batch->run[i]);
+      } else {
+        stat_add(shard, batch->file, STAT_WRITEBACKS);
+      }
+      // Counted down frame by frame, so that it stays right for a peer
+      // that dies halfway through.
+      mutex_lock(&f->lock);
+      --f->writeback;
+      (void)pthread_mutex_unlock(&f->lock);
+      event_broadcast(&shard->io_done);
+      (void)pthread_mutex_unlock(&shard->lock);
+    }
+    off_t run_end =
+        (batch->first[r] + (off_t)(end - batch->start[r])) * VTPC_BLOCK_SIZE;
+    if (failed && batch->error == 0) {
+      batch->error = batch->ios[r].error;
+    } else if (!failed && run_end > disk_end) {
+      disk_end = run_end;
+    }
+  }
+
+  mutex_lock(&f->lock);
+  if (disk_end > f->disk_size) {
+    f->disk_size = disk_end;
+  }
+  event_broadcast(&f->io_done);
+  (void)pthread_mutex_unlock(&f->lock);
+  flush_signal(&cache.shared->flush_done);
+  batch->runs = 0;
+  batch->frames = 0;
+}
+
+// Adds a claimed frame to the batch, continuing the last run if `extend`.
+static void batch_push(
+    struct flush_batch* batch, off_t block, uint32_t idx, bool extend
+) {
+  if (batch->frames == RUN_MAX ||
+      (!extend && batch->runs == VTPC_IO_DEPTH)) {
+    batch_write(batch);
+    extend = false;
+  }
+  if (!extend) {
+    batch->first[batch->runs] = block;
+    batch->start[batch->runs] = batch->frames;
+    ++batch->runs;
+  }
+  batch->run[batch->frames++] = idx;
+}
+
+struct dirty_block {
+  off_t block;
+  uint32_t idx;
+};
+
+static int dirty_block_cmp(const void* lhs, const void* rhs) {
+  const struct dirty_block* a = lhs;
+  const struct dirty_block* b = rhs;
+  return (a->block > b->block) - (a->block < b->block);
+}
+
+// Claims `count` snapshot entries holding consecutive blocks for the batch.
+// Entries that are no longer dirty are skipped; those another thread is
+// writing back right now are counted in `busy`.
+static void claim_extent(
+    struct flush_batch* batch,
+    const struct dirty_block* blocks,
+    size_t count,
+    size_t* busy
+) {
+  bool extend = false;
+  for (size_t i = 0; i < count; ++i) {
+    bool claimed = false;
+    struct shard* shard = shard_of(batch->file, blocks[i].block);
+    mutex_lock(&shard->lock);
+    const struct frame* frame = &cache.frames[blocks[i].idx];
+    bool same = frame->file == batch->file && frame->block == blocks[i].block;
+    while (same && frame->dirty && frame->loading) {
+      // Being filled in by a reader, see frame_fill().
+      event_wait(&shard->io_done, &shard->lock);
+      same = frame->file == batch->file && frame->block == blocks[i].block;
+    }
+    if (same && frame_flushable(blocks[i].idx) && frame->valid > 0 &&
+        frame_fill(shard, blocks[i].idx) == -1 && batch->error == 0) {
+      batch->error = errno;
+    }
+    if (same) {
+      claimed = frame_flushable(blocks[i].idx) && frame->valid == 0;
+      *busy += (frame->dirty && frame->writeback) ? 1 : 0;
+    }
+    if (claimed) {
+      frame_clean(blocks[i].idx, true);
+    }
+    (void)pthread_mutex_unlock(&shard->lock);
+
+    if (claimed) {
+      batch_push(batch, blocks[i].block, blocks[i].idx, extend);
+    }
+    extend = claimed;
+  }
+}
+
+// Writes back the dirty blocks of a file in offset order, merging adjacent
+// blocks into runs and submitting up to VTPC_IO_DEPTH runs at once. In the
+// background, stops once the cache is back under the background mark.
+static int file_flush(int file, bool background, size_t* busy) {
+  struct file* f = &cache.files[file];
+  mutex_lock(&f->lock);
+  size_t count = f->dirty.size;
+  struct dirty_block* blocks = malloc((count + 1) * sizeof(*blocks));
+  struct flush_batch* batch = malloc(sizeof(*batch));
+  if (blocks == NULL || batch == NULL) {
+    (void)pthread_mutex_unlock(&f->lock);
+    free(blocks);
+    free(batch);
+    errno = ENOMEM;
+    return -1;
+  }
+  size_t n = 0;
+  for (uint32_t idx = f->dirty.head; idx != VTPC_NIL;
+       idx = cache.dirty_links[idx].next) {
+    blocks[n++] = (struct dirty_block){cache.frames[idx].block, idx};
+  }
+  (void)pthread_mutex_unlock(&f->lock);
+  qsort(blocks, count, sizeof(*blocks), dirty_block_cmp);
+
+  batch->file = file;
+  batch->runs = 0;
+  batch->frames = 0;
+  batch->error = 0;
+  size_t i = 0;
+  while (i < count && batch->error == 0) {
+    if (background &&
+        atomic_load(&cache.shared->dirty) <= cache.shared->dirty_background) {
+      break;
+    }
+    size_t len = 1;
+    while (i + len < count &&
+           blocks[i + len].block == blocks[i].block + (off_t)len) {
+      ++len;
+    }
+    claim_extent(batch, blocks + i, len, busy);
+    i += len;
+  }
+  batch_write(batch);
+
+  int error = batch->error;
+  free(blocks);
+  free(batch);
+  if (error != 0) {
+    errno = error;
+    return -1;
+  }
+  return 0;
+}
+
+// Writes back every block that is dirty on entry, including those another
+// thread was writing back already, and waits until all of it is on disk.
+static int file_flush_all(int file) {
+  size_t busy = 0;
+  do {
+    // An older copy of a block may still be in flight; let it land first so
+    // that it cannot overwrite what is written now.
+    wait_writeback(&cache.files[file]);
+    busy = 0;
+    if (file_flush(file, false, &busy) == -1) {
+      return -1;
+    }
+  } while (busy > 0);
+  wait_writeback(&cache.files[file]);
+  return 0;
+}
+
+// Keeps writers from dirtying the cache faster than it can be written back.
+static int balance_dirty(int file) {
+  if (atomic_load(&cache.shared->dirty) <= cache.shared->dirty_limit) {
+    return 0;
+  }
+  if (!cache.flusher) {
+    size_t busy = 0;
+    return file_flush(file, false, &busy);
+  }
+  mutex_lock(&cache.shared->flush_lock);
+  while (atomic_load(&cache.shared->dirty) > cache.shared->dirty_limit) {
+    event_broadcast(&cache.shared->flush_wake);
+    event_wait(&cache.shared->flush_done, &cache.shared->flush_lock);
+  }
+  (void)pthread_mutex_unlock(&cache.shared->flush_lock);
+  return 0;
+}
+
+static int dirty_file_next(int* rotor) {
+  for (int i = 0; i < VTPC_MAX_FILES; ++i) {
+    int id = (*rotor + i) % VTPC_MAX_FILES;
+    mutex_lock(&cache.files[id].lock);
+    bool dirty = cache.files[id].used && cache.files[id].dirty.size > 0;
+    (void)pthread_mutex_unlock(&cache.files[id].lock);
+    if (dirty) {
+      *rotor = (id + 1) % VTPC_MAX_FILES;
+      return id;
+    }
+  }
+  return -1;
+}
+
+static void* flusher_main(void* arg) {
+  (void)arg;
+  int rotor = 0;
+  mutex_lock(&cache.shared->flush_lock);
+  while (true) {
+    while (atomic_load(&cache.shared->dirty) <=
+           cache.shared->dirty_background) {
+      event_wait(&cache.shared->flush_wake, &cache.shared->flush_lock);
+    }
+    (void)pthread_mutex_unlock(&cache.shared->flush_lock);
+
+    int file = dirty_file_next(&rotor);
+    size_t busy = 0;
+    bool stuck = file == -1 || file_flush(file, true, &busy) == -1;
+    if (!stuck && busy > 0) {
+      wait_writeback(&cache.files[file]);
+    }
+
+    mutex_lock(&cache.shared->flush_lock);
+    if (stuck) {
+      // Nothing the flusher can write right now, or the disk is failing:
+      // back off instead of spinning.
+      event_wait_for(
+          &cache.shared->flush_wake, &cache.shared->flush_lock, 1000000000L
+      );
+    }
+  }
+  return NULL;
+}
+
+static struct file* file_get(int file) {
+  if (file < 0 || file >= VTPC_MAX_FILES || !cache.files[file].used) {
+    errno = EBADF;
+    return NULL;
+  }
+  return &cache.files[file];
+}
+
+static int file_truncate(int file) {
+  struct file* f = &cache.files[file];
+  int result = 0;
+  mutex_lock(&f->lock);
+  if (f->disk_size != f->size) {
+    int fd = file_fd(file);
+    result = (fd == -1) ? -1 : ftruncate(fd, f->size);
+    if (result == 0) {
+      f->disk_size = f->size;
+    }
+  }
+  (void)pthread_mutex_unlock(&f->lock);
+  return result;
+}
+
+// Drops every cached block of the file. Blocks still borrowed by read
+// views stay in place but are zeroed, as the file no longer holds them.
+static void file_discard(int file) {
+  for (uint32_t s = 0; s < cache.shard_count; ++s) {
+    struct shard* shard = &cache.shards[s];
+    mutex_lock(&shard->lock);
+    for (uint32_t i = shard->base; i < shard->base + shard->capacity; ++i) {
+      while (cache.frames[i].file == file && frame_busy(&cache.frames[i])) {
+        event_wait(&shard->io_done, &shard->lock);
+      }
+      if (cache.frames[i].file != file) {
+        continue;
+      }
+      if (cache.frames[i].pins > 0) {
+        frame_clean(i, false);
+        memset(frame_data(i), 0, VTPC_BLOCK_SIZE);
+        cache.frames[i].valid = 0;
+      } else {
+        frame_release(shard, i);
+      }
+    }
+    zpool_forget(shard, file);
+    (void)pthread_mutex_unlock(&shard->lock);
+  }
+  // Writers throttled on dirty blocks this dropped must notice.
+  flush_signal(&cache.shared->flush_done);
+  wait_writeback(&cache.files[file]);
+}
+
+// O_TRUNC is applied here rather than by open(2), so that blocks other
+// handles still have cached or in flight cannot outlive it.
+static int file_truncate_all(int file) {
+  struct file* f = &cache.files[file];
+  file_discard(file);
+  int fd = file_fd(file);
+  mutex_lock(&f->lock);
+  int result = (fd == -1) ? -1 : ftruncate(fd, 0);
+  if (result == 0) {
+    f->size = 0;
+    f->disk_size = 0;
+  }
+  (void)pthread_mutex_unlock(&f->lock);
+  return result;
+}
+
+// Closes the descriptor of this process for `file`.
+static int file_fd_close(int file) {
+  (void)pthread_mutex_lock(&fds_lock);
+  int fd = fds[file].fd;
+  fds[file].fd = -1;
+  fds[file].read_only = false;
+  (void)pthread_mutex_unlock(&fds_lock);
+  return (fd == -1) ? 0 : close(fd);
+}
+
+// Keeps `fd` as the descriptor of this process for `file`, unless it has
+// a current one already that is writable whenever `fd` is.
+static void file_fd_adopt(int file, int fd, bool read_only) {
+  uint32_t generation =
+      __atomic_load_n(&cache.files[file].generation, __ATOMIC_ACQUIRE);
+  (void)pthread_mutex_lock(&fds_lock);
+  if (fds[file].fd != -1 && fds[file].generation == generation &&
+      (read_only || !fds[file].read_only)) {
+    (void)close(fd);
+  } else {
+    if (fds[file].fd != -1) {
+      (void)close(fds[file].fd);
+    }
+    fds[file].fd = fd;
+    fds[file].generation = generation;
+    fds[file].read_only = read_only;
+  }
+  (void)pthread_mutex_unlock(&fds_lock);
+}
+
+static bool file_read_only(int file) {
+  (void)pthread_mutex_lock(&fds_lock);
+  bool read_only = fds[file].read_only;
+  (void)pthread_mutex_unlock(&fds_lock);
+  return read_only;
+}
+
+// Keeps the manifest of `file` next to `path`, once VTPC_MANIFEST is set;
+// `due` marks it to be warmed up from.
+static void manifest_track(int file, const char* path, bool due) {
+  char* name = NULL;
+  if (manifest_suffix == NULL ||
+      asprintf(&name, "%s%s", path, manifest_suffix) == -1) {
+    return;
+  }
+  (void)pthread_mutex_lock(&fds_lock);
+  free(manifests[file].path);
+  manifests[file].path = name;
+  manifests[file].due = manifests[file].due || due;
+  (void)pthread_mutex_unlock(&fds_lock);
+}
+
+struct hot_block {
+  uint64_t touched;
+  uint64_t block;
+};
+
+// Most recently used first.
+static int hot_block_cmp(const void* lhs, const void* rhs) {
+  const struct hot_block* a = lhs;
+  const struct hot_block* b = rhs;
+  return (a->touched < b->touched) - (a->touched > b->touched);
+}
+
+// Lists the cached blocks of `file` in its manifest, if this process keeps
+// one for it.
+static void manifest_save(int file) {
+  (void)pthread_mutex_lock(&fds_lock);
+  char* path = manifests[file].path;
+  manifests[file].path = NULL;
+  (void)pthread_mutex_unlock(&fds_lock);
+  struct hot_block* hot =
+      (path != NULL) ? malloc(cache.capacity * sizeof(*hot)) : NULL;
+  if (hot == NULL) {
+    free(path);
+    return;
+  }
+
+  size_t count = 0;
+  for (uint32_t s = 0; s < cache.shard_count; ++s) {
+    struct shard* shard = &cache.shards[s];
+    mutex_lock(&shard->lock);
+    for (uint32_t i = shard->base; i < shard->base + shard->capacity; ++i) {
+      const struct frame* frame = &cache.frames[i];
+      if (frame->file == file && !frame->loading) {
+        hot[count].touched = frame->touched;
+        hot[count].block = (uint64_t)frame->block;
+        ++count;
+      }
+    }
+    (void)pthread_mutex_unlock(&shard->lock);
+  }
+  qsort(hot, count, sizeof(*hot), hot_block_cmp);
+  // Packed in place: each block moves to an earlier slot than it is read
+  // from.
+  uint64_t* blocks = (uint64_t*)hot;
+  for (size_t i = 0; i < count; ++i) {
+    blocks[i] = hot[i].block;
+  }
+  (void)vtpc_manifest_write(path, blocks, count);
+  free(hot);
+  free(path);
+}
+
+// Writes the manifests of the files this process still has open.
+static void manifests_save(void) {
+  for (int file = 0; file < VTPC_MAX_FILES; ++file) {
+    mutex_lock(&cache.shared->files_lock);
+    bool open = cache.peers[cache.peer].refs[file] > 0;
+    (void)pthread_mutex_unlock(&cache.shared->files_lock);
+    if (open) {
+      manifest_save(file);
+    }
+  }
+}
+
+// Runs the last close of a file marked `closing`: writes it back and drops
+// its blocks, or keeps them for the next process to open the file when
+// the cache is shared and `discard` is not set.
+static int file_retire(int file, bool discard) {
+  struct file* f = &cache.files[file];
+  if (!discard) {
+    manifest_save(file);
+  }
+  int result = file_flush_all(file);
+  if (result == 0) {
+    result = file_truncate(file);
+  }
+  if (discard || !cache.shm) {
+    file_discard(file);
+  }
+
+  // The next open checks against this that nobody changed the file behind
+  // the cache's back.
+  struct timespec mtime = {0, 0};
+  struct stat st;
+  int fd = file_fd(file);
+  if (!discard && fd != -1 && fstat(fd, &st) == 0) {
+    mtime = st.st_mtim;
+  }
+  if (fd == -1 || file_fd_close(file) == -1) {
+    result = -1;
+  }
+
+  mutex_lock(&cache.shared->files_lock);
+  mutex_lock(&f->lock);
+  f->used = cache.shm;
+  f->mtime = mtime;
+  f->closing = false;
+  (void)pthread_mutex_unlock(&f->lock);
+  event_broadcast(&cache.shared->files_closed);
+  (void)pthread_mutex_unlock(&cache.shared->files_lock);
+  return result;
+}
+
+// Frees the slot of a file nobody has open, marked `closing`.
+static void file_evict(int file) {
+  struct file* f = &cache.files[file];
+  (void)file_flush_all(file);
+  file_discard(file);
+  (void)file_fd_close(file);
+  mutex_lock(&cache.shared->files_lock);
+  mutex_lock(&f->lock);
+  f->used = false;
+  f->closing = false;
+  (void)pthread_mutex_unlock(&f->lock);
+  event_broadcast(&cache.shared->files_closed);
+  (void)pthread_mutex_unlock(&cache.shared->files_lock);
+}
+
+static void file_ref(int file, int delta) {
+  cache.files[file].refs += (uint32_t)delta;
+  cache.peers[cache.peer].refs[file] += (uint16_t)delta;
+}
+
+static bool file_stale(const struct file* f, const struct stat* st) {
+  return f->mtime.tv_sec != st->st_mtim.tv_sec ||
+         f->mtime.tv_nsec != st->st_mtim.tv_nsec || f->size != st->st_size;
+}
+
+static int file_lookup(const struct stat* st) {
+  for (int file = 0; file < VTPC_MAX_FILES; ++file) {
+    const struct file* f = &cache.files[file];
+    if (f->used && f->dev == st->st_dev && f->ino == st->st_ino) {
+      return file;
+    }
+  }
+  return -1;
+}
+
+// Returns an unused slot or, failing that, marks the slot of a file that
+// nobody has open as closing and returns it as `idle`.
+static int file_vacant(int* idle) {
+  int candidate = -1;
+  for (int file = 0; file < VTPC_MAX_FILES; ++file) {
+    struct file* f = &cache.files[file];
+    if (!f->used) {
+      *idle = -1;
+      return file;
+    }
+    if (candidate == -1 && f->refs == 0 && !f->closing) {
+      candidate = file;
+    }
+  }
+  if (candidate != -1) {
+    cache.files[candidate].closing = true;
+    cache.files[candidate].closer = cache.peer;
+  }
+  *idle = candidate;
+  return -1;
+}
+
+// Takes a reference to the slot caching the inode `st` describes, which
+// `fd` is open on. A new slot starts out truncated if `truncate`, and then
+// `fresh` is set.
+static int file_acquire(
+    const struct stat* st,
+    const char* path,
+    int fd,
+    bool truncate,
+    bool* fresh
+) {
+  struct shared* shared = cache.shared;
+  mutex_lock(&shared->files_lock);
+  while (true) {
+    int file = file_lookup(st);
+    struct file* f = (file == -1) ? NULL : &cache.files[file];
+    if (f != NULL && f->closing) {
+      event_wait(&shared->files_closed, &shared->files_lock);
+      continue;
+    }
+    if (f != NULL && f->refs == 0 && file_stale(f, st)) {
+      // Changed behind the cache's back since the last close.
+      f->closing = true;
+      f->closer = cache.peer;
+      (void)pthread_mutex_unlock(&shared->files_lock);
+      file_discard(file);
+      mutex_lock(&f->lock);
+      f->size = st->st_size;
+      f->disk_size = st->st_size;
+      f->mtime = st->st_mtim;
+      (void)pthread_mutex_unlock(&f->lock);
+      mutex_lock(&shared->files_lock);
+      f->closing = false;
+      event_broadcast(&shared->files_closed);
+    }
+    if (f != NULL && f->refs == 0) {
+      // Peers may hold descriptors of a deleted file whose inode number
+      // this one was given, or the file may be reached by another path.
+      __atomic_store_n(&f->generation, f->generation + 1, __ATOMIC_RELEASE);
+      memset(f->stats, 0, sizeof(f->stats));
+      if (cache.paths != NULL) {
+        (void)snprintf(cache.paths[file], PATH_MAX, "%s", path);
+      }
+    }
+    if (f != NULL) {
+      file_ref(file, 1);
+      (void)pthread_mutex_unlock(&shared->files_lock);
+      *fresh = false;
+      return file;
+    }
+
+    int idle = -1;
+    file = file_vacant(&idle);
+    if (idle != -1) {
+      (void)pthread_mutex_unlock(&shared->files_lock);
+      file_evict(idle);
+      mutex_lock(&shared->files_lock);
+      continue;
+    }
+    if (file == -1) {
+      (void)pthread_mutex_unlock(&shared->files_lock);
+      errno = EMFILE;
+      return -1;
+    }
+    if (truncate && ftruncate(fd, 0) == -1) {
+      (void)pthread_mutex_unlock(&shared->files_lock);
+      return -1;
+    }
+
+    f = &cache.files[file];
+    mutex_lock(&f->lock);
+    f->used = true;
+    f->closing = false;
+    f->refs = 0;
+    __atomic_store_n(&f->generation, f->generation + 1, __ATOMIC_RELEASE);
+    f->dev = st->st_dev;
+    f->ino = st->st_ino;
+    f->size = truncate ? 0 : st->st_size;
+    f->disk_size = f->size;
+    f->writeback = 0;
+    f->sync_leader = -1;
+    f->sync_error = 0;
+    vtpc_list_init(&f->dirty);
+    memset(f->stats, 0, sizeof(f->stats));
+    if (cache.paths != NULL) {
+      (void)snprintf(cache.paths[file], PATH_MAX, "%s", path);
+    }
+    (void)pthread_mutex_unlock(&f->lock);
+    file_ref(file, 1);
+    (void)pthread_mutex_unlock(&shared->files_lock);
+    *fresh = true;
+    return file;
+  }
+}
+
+// Whether the process that took the slot still runs.
+static bool peer_alive(struct peer* peer) {
+  int result = pthread_mutex_trylock(&peer->life);
+  if (result == EBUSY) {
+    return true;
+  }
+  if (result == EOWNERDEAD) {
+    (void)pthread_mutex_consistent(&peer->life);
+  }
+  if (result == 0 || result == EOWNERDEAD) {
+    (void)pthread_mutex_unlock(&peer->life);
+  }
+  return false;
+}
+
+// Cleans up after a peer that died: blocks it was loading are dropped,
+// those it was writing back are dirty again and its handles are closed.
+// Blocks it had borrowed through read views stay pinned.
+static void peer_reap(int peer) {
+  for (uint32_t s = 0; s < cache.shard_count; ++s) {
+    struct shard* shard = &cache.shards[s];
+    mutex_lock(&shard->lock);
+    for (uint32_t i = shard->base; i < shard->base + shard->capacity; ++i) {
+      struct frame* frame = &cache.frames[i];
+      if (frame->file == -1 || frame->owner != peer) {
+        continue;
+      }
+      if (frame->loading && frame->valid > 0) {
+        // A fill, which leaves the frame as it was.
+        frame->loading = false;
+        --shard->loading;
+      } else if (frame->loading) {
+        frame->loading = false;
+        --shard->loading;
+        index_remove(shard, i);
+        frame_free(shard, i);
+      } else if (frame->writeback) {
+        struct file* f = &cache.files[frame->file];
+        frame->writeback = false;
+        frame_dirty(i);
+        mutex_lock(&f->lock);
+        --f->writeback;
+        event_broadcast(&f->io_done);
+        (void)pthread_mutex_unlock(&f->lock);
+      }
+    }
+    // The peer may have died halfway through an update of the index.
+    vtpc_index_clear(shard_index(shard));
+    for (uint32_t i = shard->base; i < shard->base + shard->capacity; ++i) {
+      if (cache.frames[i].file != -1) {
+        index_insert(shard, i);
+      }
+    }
+    event_broadcast(&shard->io_done);
+    (void)pthread_mutex_unlock(&shard->lock);
+  }
+  // So may the curve estimator, which then forgets its sampled blocks.
+  if (cache.mrc_state != NULL) {
+    mutex_lock(&cache.shared->mrc_lock);
+    vtpc_mrc_restart(cache.mrc_state);
+    (void)pthread_mutex_unlock(&cache.shared->mrc_lock);
+  }
+
+  // Last closes the peer left to do or did not finish fall to this process.
+  // Its blocks are dropped: the file may have changed since the peer died,
+  // and stat() can no longer tell.
+  int retire[VTPC_MAX_FILES];
+  int count = 0;
+  mutex_lock(&cache.shared->files_lock);
+  for (int file = 0; file < VTPC_MAX_FILES; ++file) {
+    struct file* f = &cache.files[file];
+    uint16_t refs = cache.peers[peer].refs[file];
+    cache.peers[peer].refs[file] = 0;
+    if (!f->used) {
+      continue;
+    }
+    f->refs -= refs;
+    mutex_lock(&f->lock);
+    if (f->sync_leader == peer) {
+      f->sync_leader = -1;
+      event_broadcast(&f->synced);
+    }
+    (void)pthread_mutex_unlock(&f->lock);
+    bool unfinished = f->closing && f->closer == peer;
+    if (unfinished || (refs > 0 && f->refs == 0 && !f->closing)) {
+      f->closing = true;
+      f->closer = cache.peer;
+      retire[count++] = file;
+    }
+  }
+  (void)pthread_mutex_unlock(&cache.shared->files_lock);
+  for (int i = 0; i < count; ++i) {
+    (void)file_retire(retire[i], true);
+  }
+  cache.peers[peer].used = false;
+}
+
+static void peers_reap_locked(void) {
+  for (uint32_t peer = 0; peer < cache.peer_count; ++peer) {
+    if ((int)peer != cache.peer && cache.peers[peer].used &&
+        !peer_alive(&cache.peers[peer])) {
+      peer_reap((int)peer);
+    }
+  }
+}
+
+// Cleans up after peers that died, unless some thread is at it already.
+static void peers_reap(void) {
+  if (!cache.shm) {
+    return;
+  }
+  int result = pthread_mutex_trylock(&cache.shared->peers_lock);
+  if (result == EOWNERDEAD) {
+    (void)pthread_mutex_consistent(&cache.shared->peers_lock);
+    result = 0;
+  }
+  if (result == 0) {
+    peers_reap_locked();
+    (void)pthread_mutex_unlock(&cache.shared->peers_lock);
+  }
+}
+
+int vtpc_cache_open(const char* path, int flags, mode_t mode) {
+  if (cache_init() == -1) {
+    return -1;
+  }
+
+  // Partial block writes need read-modify-write, so a write-only handle
+  // still has to read the backing file. Appends and the caching modes are
+  // emulated by vtpc for each handle, as the descriptor is shared. A file
+  // that cannot be written is still cached for read-only handles.
+  bool truncate = (flags & O_TRUNC) != 0;
+  bool fallback = (flags & O_ACCMODE) == O_RDONLY && !truncate;
+  flags &= ~(O_ACCMODE | O_APPEND | O_TRUNC | O_SYNC | O_DSYNC | O_DIRECT);
+
+  bool read_only = false;
+  int fd = open_backing(path, flags, mode, fallback, &read_only);
+  if (fd == -1) {
+    return -1;
+  }
+
+  // Other processes find the file by its absolute path, and so does the
+  // manifest once the working directory changed.
+  char resolved[PATH_MAX] = "";
+  struct stat st;
+  if (fstat(fd, &st) == -1 ||
+      ((cache.shm || manifest_suffix != NULL) &&
+       realpath(path, resolved) == NULL)) {
+    int err = errno;
+    (void)close(fd);
+    errno = err;
+    return -1;
+  }
+
+  peers_reap();
+  bool fresh = false;
+  int file = file_acquire(&st, resolved, fd, truncate, &fresh);
+  if (file == -1) {
+    int err = errno;
+    (void)close(fd);
+    errno = err;
+    return -1;
+  }
+  file_fd_adopt(file, fd, read_only);
+  manifest_track(file, resolved, fresh && !truncate);
+
+  if (truncate && !fresh && file_truncate_all(file) == -1) {
+    int err = errno;
+    (void)vtpc_cache_close(file);
+    errno = err;
+    return -1;
+  }
+  return file;
+}
+
+bool vtpc_cache_warm_due(int file) {
+  (void)pthread_mutex_lock(&fds_lock);
+  bool due = manifests[file].due && manifests[file].path != NULL;
+  manifests[file].due = false;
+  (void)pthread_mutex_unlock(&fds_lock);
+  return due;
+}
+
+uint64_t* vtpc_cache_manifest(int file, size_t* count) {
+  (void)pthread_mutex_lock(&fds_lock);
+  char* path = (manifests[file].path != NULL) ? strdup(manifests[file].path)
+                                              : NULL;
+  (void)pthread_mutex_unlock(&fds_lock);
+  if (path == NULL) {
+    return NULL;
+  }
+  uint64_t* blocks = vtpc_manifest_read(path, count);
+  free(path);
+  // More than the cache holds would push out the hottest blocks again.
+  uint32_t active = __atomic_load_n(&cache.shared->active, __ATOMIC_RELAXED);
+  if (*count > active) {
+    *count = active;
+  }
+  return blocks;
+}
+
+// Only the last close of an inode, in any process, writes it back.
+int vtpc_cache_close(int file) {
+  struct file* f = file_get(file);
+  if (f == NULL) {
+    return -1;
+  }
+  mutex_lock(&cache.shared->files_lock);
+  file_ref(file, -1);
+  bool last = f->refs == 0;
+  if (last) {
+    f->closing = true;
+    f->closer = cache.peer;
+  }
+  (void)pthread_mutex_unlock(&cache.shared->files_lock);
+  return last ? file_retire(file, false) : 0;
+}
+
+off_t vtpc_cache_size(int file) {
+  struct file* f = file_get(file);
+  if (f == NULL) {
+    return -1;
+  }
+  mutex_lock(&f->lock);
+  off_t size = f->size;
+  (void)pthread_mutex_unlock(&f->lock);
+  return size;
+}
+
+void vtpc_cache_identity(int file, uint64_t* dev, uint64_t* ino) {
+  struct file* f = &cache.files[file];
+  mutex_lock(&f->lock);
+  *dev = (uint64_t)f->dev;
+  *ino = (uint64_t)f->ino;
+  (void)pthread_mutex_unlock(&f->lock);
+}
+
+// Whether the blocks a stream loads go on probation: those of scans, and
+// all of them once the application said it will not reuse them.
+static bool stream_cold(const struct vtpc_stream* stream, bool sequential) {
+  return stream != NULL && ((sequential && stream->window >= SCAN_WINDOW) ||
+                            stream->advice == POSIX_FADV_NOREUSE);
+}
+
+// With POSIX_FADV_SEQUENTIAL every read goes on a stream, with
+// POSIX_FADV_RANDOM none does.
+static bool stream_continues(struct vtpc_stream* stream, off_t offset) {
+  if (stream == NULL || stream->advice == POSIX_FADV_RANDOM) {
+    return false;
+  }
+  bool sequential =
+      offset == stream->next || stream->advice == POSIX_FADV_SEQUENTIAL;
+  if (!sequential) {
+    stream->window = 0;
+  }
+  return sequential;
+}
+
+// Returns how many blocks to load from `block` on, `want` at least, when a
+// sequential stream reaches it.
+static uint32_t stream_want(
+    int file, off_t block, uint32_t want, struct vtpc_stream* stream
+) {
+  if (index_peek(file, block)) {
+    return want;
+  }
+  // Every miss inside a sequential stream opens a larger window, unless the
+  // application announced the stream.
+  if (stream->advice == POSIX_FADV_SEQUENTIAL) {
+    stream->window = READAHEAD_MAX;
+  } else {
+    stream->window =
+        (stream->window == 0) ? READAHEAD_MIN : 2 * stream->window;
+  }
+  if (stream->window > READAHEAD_MAX) {
+    stream->window = READAHEAD_MAX;
+  }
+  return (want > stream->window) ? want : stream->window;
+}
+
+// Where a vectored request stands in the caller's segments.
+struct iov_pos {
+  const struct iovec* iov;
+  size_t in;  // bytes of `iov[0]` already done
+};
+
+// Copies `len` bytes between `data` and the segments from `pos` on, into
+// the segments if `out`, and moves `pos` past them.
+static void iov_copy(struct iov_pos* pos, char* data, size_t len, bool out) {
+  while (len > 0) {
+    size_t chunk = pos->iov->iov_len - pos->in;
+    if (chunk > len) {
+      chunk = len;
+    }
+    char* segment = (char*)pos->iov->iov_base + pos->in;
+    if (out) {
+      memcpy(segment, data, chunk);
+    } else {
+      memcpy(data, segment, chunk);
+    }
+    data += chunk;
+    len -= chunk;
+    pos->in += chunk;
+    if (pos->in == pos->iov->iov_len) {
+      ++pos->iov;
+      pos->in = 0;
+    }
+  }
+}
+
+ssize_t vtpc_cache_readv(
+    int file,
+    const struct iovec* iov,
+    size_t count,
+    off_t offset,
+    struct vtpc_stream* stream
+) {
+  off_t size = vtpc_cache_size(file);
+  if (size == -1) {
+    return -1;
+  }
+
+  bool sequential = stream_continues(stream, offset);
+  if (offset >= size) {
+    return 0;
+  }
+  if (count > (size_t)(size - offset)) {
+    count = (size_t)(size - offset);
+  }
+
+  off_t last = (offset + (off_t)count - 1) / VTPC_BLOCK_SIZE;
+  struct iov_pos to = {iov, 0};
+  size_t done = 0;
+  while (done < count) {
+    off_t pos = offset + (off_t)done;
+    size_t in = (size_t)(pos % VTPC_BLOCK_SIZE);
+    size_t chunk = VTPC_BLOCK_SIZE - in;
+    if (chunk > count - done) {
+      chunk = count - done;
+    }
+
+    off_t block = pos / VTPC_BLOCK_SIZE;
+    uint32_t need = (uint32_t)(last - block + 1);
+    uint32_t want = sequential ? stream_want(file, block, need, stream) : need;
+    bool scan = stream_cold(stream, sequential);
+
+    uint32_t idx = VTPC_NIL;
+    struct shard* shard =
+        block_get(file, block, need, want, scan, (uint32_t)in, 0, &idx);
+    if (shard == NULL) {
+      if (done == 0) {
+        return -1;
+      }
+      break;
+    }
+    iov_copy(&to, frame_data(idx) + in, chunk, true);
+    (void)pthread_mutex_unlock(&shard->lock);
+    done += chunk;
+  }
+
+  if (stream != NULL) {
+    stream->next = offset + (off_t)done;
+  }
+  return (ssize_t)done;
+}
+
+// Copies the bytes of `block` from `in` on into `to` if the block is cached,
+// waiting for it to finish loading. Returns 1 if it did, 0 if the block is
+// not cached, or -1.
+static int block_copy_cached(
+    int file, off_t block, size_t in, size_t chunk, struct iov_pos* to
+) {
+  struct shard* shard = shard_of(file, block);
+  uint32_t guess = index_guess(file, block);
+  mutex_lock(&shard->lock);
+  while (true) {
+    uint32_t idx = index_confirm(shard, guess, file, block);
+    if (idx == VTPC_NIL) {
+      (void)pthread_mutex_unlock(&shard->lock);
+      return 0;
+    }
+    if (cache.frames[idx].loading) {
+      event_wait(&shard->io_done, &shard->lock);
+      continue;
+    }
+    if (cache.frames[idx].valid > in) {
+      if (frame_fill(shard, idx) == -1) {
+        (void)pthread_mutex_unlock(&shard->lock);
+        return -1;
+      }
+      continue;
+    }
+    iov_copy(to, frame_data(idx) + in, chunk, true);
+    (void)pthread_mutex_unlock(&shard->lock);
+    return 1;
+  }
+}
+
+ssize_t vtpc_cache_read_direct(
+    int file, const struct iovec* iov, size_t count, off_t offset
+) {
+  off_t size = vtpc_cache_size(file);
+  if (size == -1) {
+    return -1;
+  }
+  if (offset >= size) {
+    return 0;
+  }
+  if (count > (size_t)(size - offset)) {
+    count = (size_t)(size - offset);
+  }
+
+  off_t last = (offset + (off_t)count - 1) / VTPC_BLOCK_SIZE;
+  off_t blocks = last - (offset / VTPC_BLOCK_SIZE) + 1;
+  uint32_t most = (blocks < RUN_MAX) ? (uint32_t)blocks : RUN_MAX;
+  // O_DIRECT reads whole blocks into aligned memory only.
+  char* buffer = aligned_alloc(VTPC_BLOCK_SIZE, most * VTPC_BLOCK_SIZE);
+  if (buffer == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+  struct iov_pos to = {iov, 0};
+  size_t done = 0;
+  int err = 0;
+  while (done < count && err == 0) {
+    off_t pos = offset + (off_t)done;
+    off_t block = pos / VTPC_BLOCK_SIZE;
+    size_t in = (size_t)(pos % VTPC_BLOCK_SIZE);
+    size_t chunk = VTPC_BLOCK_SIZE - in;
+    if (chunk > count - done) {
+      chunk = count - done;
+    }
+    int cached = block_copy_cached(file, block, in, chunk, &to);
+    if (cached != 0) {
+      err = (cached == -1) ? errno : 0;
+      done += (cached == 1) ? chunk : 0;
+      continue;
+    }
+
+    // Blocks missing from the cache are as current on the disk, where the
+    // run of them that starts here is read in one go.
+    uint32_t run = 1;
+    while (run < most && block + run <= last &&
+           !index_peek(file, block + run)) {
+      ++run;
+    }
+    struct iovec part = {buffer, run * VTPC_BLOCK_SIZE};
+    struct vtpc_io io = {
+        file_fd(file), false, &part, 1, block * VTPC_BLOCK_SIZE, 0, 0
+    };
+    if (io.fd == -1) {
+      err = errno;
+      continue;
+    }
+    vtpc_io_run(&io, 1);
+    if (io.result == -1) {
+      err = io.error;
+      continue;
+    }
+    // What lies past the end of the disk reads as zeros.
+    memset(buffer + io.result, 0, (run * VTPC_BLOCK_SIZE) - (size_t)io.result);
+    size_t span = (run * VTPC_BLOCK_SIZE) - in;
+    if (span > count - done) {
+      span = count - done;
+    }
+    iov_copy(&to, buffer + in, span, true);
+    done += span;
+  }
+  free(buffer);
+  if (done == 0 && err != 0) {
+    errno = err;
+    return -1;
+  }
+  return (ssize_t)done;
+}
+
+ssize_t vtpc_cache_pin(
+    int file,
+    off_t offset,
+    size_t count,
+    struct vtpc_stream* stream,
+    const void** data,
+    uint32_t* frame
+) {
+  off_t size = vtpc_cache_size(file);
+  if (size == -1) {
+    return -1;
+  }
+
+  bool sequential = stream_continues(stream, offset);
+  if (offset >= size || count == 0) {
+    return 0;
+  }
+  size_t in = (size_t)(offset % VTPC_BLOCK_SIZE);
+  if (count > VTPC_BLOCK_SIZE - in) {
+    count = VTPC_BLOCK_SIZE - in;
+  }
+  if (count > (size_t)(size - offset)) {
+    count = (size_t)(size - offset);
+  }
+
+  off_t block = offset / VTPC_BLOCK_SIZE;
+  uint32_t want = sequential ? stream_want(file, block, 1, stream) : 1;
+  bool scan = stream_cold(stream, sequential);
+  uint32_t idx = VTPC_NIL;
+  struct shard* shard =
+      block_get(file, block, 1, want, scan, (uint32_t)in, 0, &idx);
+  if (shard == NULL) {
+    return -1;
+  }
+  if (cache.frames[idx].pins++ == 0) {
+    ++shard->pinned;
+  }
+  (void)pthread_mutex_unlock(&shard->lock);
+
+  if (stream != NULL) {
+    stream->next = offset + (off_t)count;
+  }
+  *data = frame_data(idx) + in;
+  *frame = idx;
+  return (ssize_t)count;
+}
+
+void vtpc_cache_unpin(uint32_t frame) {
+  // A pinned frame keeps its block, so the shard can be found unlocked.
+  struct frame* f = &cache.frames[frame];
+  struct shard* shard = shard_of(f->file, f->block);
+  mutex_lock(&shard->lock);
+  if (--f->pins == 0) {
+    --shard->pinned;
+    event_broadcast(&shard->io_done);
+  }
+  (void)pthread_mutex_unlock(&shard->lock);
+}
+
+ssize_t vtpc_cache_writev(
+    int file, const struct iovec* iov, size_t count, off_t offset
+) {
+  struct file* f = file_get(file);
+  if (f == NULL) {
+    return -1;
+  }
+  if (file_read_only(file)) {
+    errno = EBADF;
+    return -1;
+  }
+  if ((uint64_t)offset + count > MAX_OFFSET) {
+    errno = EFBIG;
+    return -1;
+  }
+
+  struct iov_pos from = {iov, 0};
+  size_t done = 0;
+  while (done < count) {
+    off_t pos = offset + (off_t)done;
+    size_t in = (size_t)(pos % VTPC_BLOCK_SIZE);
+    size_t chunk = VTPC_BLOCK_SIZE - in;
+    if (chunk > count - done) {
+      chunk = count - done;
+    }
+
+    uint32_t idx = VTPC_NIL;
+    struct shard* shard = block_get(
+        file,
+        pos / VTPC_BLOCK_SIZE,
+        1,
+        1,
+        false,
+        (uint32_t)in,
+        (uint32_t)(in + chunk),
+        &idx
+    );
+    if (shard == NULL) {
+      if (done == 0) {
+        return -1;
+      }
+      break;
+    }
+    iov_copy(&from, frame_data(idx) + in, chunk, false);
+    if (cache.frames[idx].valid > in) {
+      cache.frames[idx].valid = (uint32_t)in;
+    }
+    frame_dirty(idx);
+    // Grown with the shard locked, so that a write taking a frame without
+    // reading it never mistakes these bytes for ones past the end.
+    mutex_lock(&f->lock);
+    if (pos + (off_t)chunk > f->size) {
+      f->size = pos + (off_t)chunk;
+    }
+    (void)pthread_mutex_unlock(&f->lock);
+    (void)pthread_mutex_unlock(&shard->lock);
+    done += chunk;
+  }
+
+  if (balance_dirty(file) == -1 && done == 0) {
+    return -1;
+  }
+  return (ssize_t)done;
+}
+
+int vtpc_cache_advice(int file, off_t offset, uint64_t hint) {
+  if (file_get(file) == NULL) {
+    return -1;
+  }
+  if (offset < 0 || (uint64_t)offset >= MAX_OFFSET) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (cache.policy->advise == NULL) {
+    return 0;
+  }
+
+  off_t block = offset / VTPC_BLOCK_SIZE;
+  struct shard* shard = shard_of(file, block);
+  mutex_lock(&shard->lock);
+  uint32_t idx = index_lookup(shard, file, block);
+  uint32_t local = VTPC_NIL;
+  if (idx != VTPC_NIL && !cache.frames[idx].loading &&
+      !cache.frames[idx].cold) {
+    local = idx - shard->base;
+  }
+  cache.policy->advise(shard_policy(shard), local, key_of(file, block), hint);
+  (void)pthread_mutex_unlock(&shard->lock);
+  return 0;
+}
+
+// Turns `count` bytes from `offset` on into a range of blocks, clipped to
+// the end of the file. Returns false if the range is empty.
+static bool block_range(
+    int file, off_t offset, size_t count, off_t* first, off_t* last
+) {
+  off_t size = vtpc_cache_size(file);
+  if (size == -1 || offset >= size || count == 0) {
+    return false;
+  }
+  if (count > (size_t)(size - offset)) {
+    count = (size_t)(size - offset);
+  }
+  *first = offset / VTPC_BLOCK_SIZE;
+  *last = (offset + (off_t)count - 1) / VTPC_BLOCK_SIZE;
+  return true;
+}
+
+int vtpc_cache_prefetch(int file, off_t offset, size_t count, bool cold) {
+  if (file_get(file) == NULL) {
+    return -1;
+  }
+  off_t block = 0;
+  off_t last = 0;
+  if (!block_range(file, offset, count, &block, &last)) {
+    return 0;
+  }
+  // More would push out what was prefetched first.
+  off_t most = __atomic_load_n(&cache.shared->active, __ATOMIC_RELAXED) / 2;
+  if (last - block >= most) {
+    last = block + most - 1;
+  }
+
+  while (block <= last) {
+    struct shard* shard = shard_of(file, block);
+    uint32_t idx = VTPC_NIL;
+    if (index_peek(file, block)) {
+      ++block;
+      continue;
+    }
+    mutex_lock(&shard->lock);
+    if (index_lookup(shard, file, block) == VTPC_NIL) {
+      idx = frame_start_load(shard, file, block);
+    }
+    if (idx != VTPC_NIL) {
+      cache.frames[idx].prefetched = true;
+      stat_add(shard, file, STAT_READAHEAD);
+    }
+    (void)pthread_mutex_unlock(&shard->lock);
+    if (idx == VTPC_NIL) {
+      // Cached, on its way, or no frame to spare: nothing to wait for.
+      ++block;
+      continue;
+    }
+    int loaded =
+        fill_run(file, block, idx, 0, (uint32_t)(last - block + 1), cold);
+    if (loaded == -1) {
+      return -1;
+    }
+    block += loaded;
+  }
+  return 0;
+}
+
+int vtpc_cache_drop(int file, off_t offset, size_t count, bool wait) {
+  if (file_get(file) == NULL) {
+    return -1;
+  }
+  off_t first = 0;
+  off_t last = 0;
+  if (!block_range(file, offset, count, &first, &last)) {
+    return 0;
+  }
+
+  int err = 0;
+  for (off_t block = first; block <= last; ++block) {
+    struct shard* shard = shard_of(file, block);
+    mutex_lock(&shard->lock);
+    uint32_t idx = index_lookup(shard, file, block);
+    while (wait && idx != VTPC_NIL && frame_busy(&cache.frames[idx])) {
+      event_wait(&shard->io_done, &shard->lock);
+      idx = index_lookup(shard, file, block);
+    }
+    if (idx != VTPC_NIL && frame_evictable(idx - shard->base, shard)) {
+      if (cache.frames[idx].dirty && write_cluster(shard, idx) == -1) {
+        err = errno;
+      } else {
+        stat_add(shard, file, STAT_EVICTIONS);
+        frame_release(shard, idx);
+      }
+    } else if (idx != VTPC_NIL && wait && cache.frames[idx].dirty &&
+               write_cluster(shard, idx) == -1) {
+      // Pinned by a view: written back all the same, but it stays.
+      err = errno;
+    }
+    zpool_remove(shard, key_of(file, block));
+    (void)pthread_mutex_unlock(&shard->lock);
+  }
+  errno = err;
+  return (err == 0) ? 0 : -1;
+}
+
+// Moves the limit of a shard whose lock is held. The frames given up are
+// emptied, clean ones first, dirty ones once written back; those pinned or
+// busy with I/O stay until evicted. Returns -1 if some dirty block could
+// not be written.
+static int shard_resize(struct shard* shard, uint32_t limit, uint32_t scan) {
+  uint32_t old = shard->limit;
+  shard->limit = limit;
+  shard->probation_min = (uint32_t)(((uint64_t)limit * scan + 99) / 100);
+  for (uint32_t local = old; local < limit; ++local) {
+    if (cache.frames[shard->base + local].file == -1) {
+      frame_free(shard, shard->base + local);
+    }
+  }
+
+  uint32_t* link = &shard->free;
+  while (*link != VTPC_NIL) {
+    uint32_t idx = *link;
+    if (idx - shard->base >= limit) {
+      *link = cache.frames[idx].next;
+      frame_offline(idx);
+    } else {
+      link = &cache.frames[idx].next;
+    }
+  }
+
+  int err = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (uint32_t local = limit; local < shard->capacity; ++local) {
+      uint32_t idx = shard->base + local;
+      const struct frame* frame = &cache.frames[idx];
+      if (frame->file == -1 || !frame_evictable(local, shard) ||
+          (frame->dirty && pass == 0)) {
+        continue;
+      }
+      if (frame->dirty && write_cluster(shard, idx) == -1) {
+        err = errno;
+        continue;
+      }
+      stat_add(shard, frame->file, STAT_EVICTIONS);
+      frame_release(shard, idx);
+    }
+  }
+  errno = err;
+  return (err == 0) ? 0 : -1;
+}
+
+// Spreads `capacity` frames over the shards and moves the dirty marks with
+// them. Runs under the resize lock, or while the cache is formatted.
+static int cache_resize(uint32_t capacity) {
+  struct shared* shared = cache.shared;
+  __atomic_store_n(&shared->active, capacity, __ATOMIC_RELAXED);
+  shared->dirty_background =
+      (uint32_t)(((uint64_t)capacity * shared->background_ratio) / 100);
+  shared->dirty_limit =
+      (shared->limit_ratio > 0)
+          ? (uint32_t)(((uint64_t)capacity * shared->limit_ratio) / 100)
+          : capacity;
+
+  int err = 0;
+  for (uint32_t i = 0; i < cache.shard_count; ++i) {
+    struct shard* shard = &cache.shards[i];
+    uint32_t limit = shard_share(i, capacity);
+    mutex_lock(&shard->lock);
+    if (shard_resize(shard, limit, shared->scan_ratio) == -1) {
+      err = errno;
+    }
+    (void)pthread_mutex_unlock(&shard->lock);
+  }
+  if (atomic_load(&shared->dirty) > shared->dirty_background &&
+      (cache.flusher || cache.shm)) {
+    flush_signal(&shared->flush_wake);
+  }
+  errno = err;
+  return (err == 0) ? 0 : -1;
+}
+
+int vtpc_cache_resize(uint32_t capacity) {
+  if (cache_init() == -1) {
+    return -1;
+  }
+  if (capacity < cache.shard_count || capacity > cache.capacity) {
+    errno = EINVAL;
+    return -1;
+  }
+  mutex_lock(&cache.shared->resize_lock);
+  cache.shared->target = capacity;
+  int result = cache_resize(capacity);
+  (void)pthread_mutex_unlock(&cache.shared->resize_lock);
+  return result;
+}
+
+void vtpc_cache_pressure(bool high) {
+  struct shared* shared = cache.shared;
+  mutex_lock(&shared->resize_lock);
+  uint32_t active = shared->active;
+  uint32_t step = high ? active / PRESSURE_SHRINK_DIV
+                       : shared->target / PRESSURE_GROW_DIV;
+  step = (step > 0) ? step : 1;
+  uint32_t next = high ? active - step : active + step;
+  uint32_t least = shared->target / PRESSURE_FLOOR_DIV;
+  least = (least > cache.shard_count) ? least : cache.shard_count;
+  if (next < least) {
+    next = least;
+  }
+  if (next > shared->target) {
+    next = shared->target;
+  }
+  if (next != active) {
+    (void)cache_resize(next);
+  }
+  (void)pthread_mutex_unlock(&shared->resize_lock);
+}
+
+static int file_sync(int file) {
+  if (file_flush_all(file) == -1 || file_truncate(file) == -1) {
+    return -1;
+  }
+  int fd = file_fd(file);
+  return (fd == -1) ? -1 : fsync(fd);
+}
+
+int vtpc_cache_sync(int file) {
+  struct file* f = file_get(file);
+  if (f == NULL) {
+    return -1;
+  }
+  mutex_lock(&f->lock);
+  // Any sync that starts to flush from now on covers what the caller wrote.
+  uint64_t need = f->syncs_begun + 1;
+  while (f->syncs_done < need) {
+    if (f->sync_leader != -1) {
+      event_wait(&f->synced, &f->lock);
+      continue;
+    }
+    f->sync_leader = cache.peer;
+    if (cache.sync_window_ns > 0) {
+      (void)pthread_mutex_unlock(&f->lock);
+      struct timespec window = {
+          .tv_sec = cache.sync_window_ns / 1000000000L,
+          .tv_nsec = cache.sync_window_ns % 1000000000L,
+      };
+      while (nanosleep(&window, &window) == -1 && errno == EINTR) {
+      }
+      mutex_lock(&f->lock);
+    }
+    uint64_t sync = ++f->syncs_begun;
+    (void)pthread_mutex_unlock(&f->lock);
+    int err = (file_sync(file) == -1) ? errno : 0;
+    mutex_lock(&f->lock);
+    f->syncs_done = sync;
+    f->sync_error = err;
+    f->sync_leader = -1;
+    event_broadcast(&f->synced);
+  }
+  // A later sync than needed covers the caller just as well.
+  int err = f->sync_error;
+  (void)pthread_mutex_unlock(&f->lock);
+  errno = err;
+  return (err == 0) ? 0 : -1;
+}
+
+void vtpc_cache_stats(int file, struct vtpc_stats* stats) {
+  uint64_t sum[STAT_COUNT] = {0};
+  if (file >= 0) {
+    for (int i = 0; i < STAT_COUNT; ++i) {
+      sum[i] = __atomic_load_n(&cache.files[file].stats[i], __ATOMIC_RELAXED);
+    }
+  } else if (cache_init() == 0) {
+    for (uint32_t s = 0; s < cache.shard_count; ++s) {
+      struct shard* shard = &cache.shards[s];
+      mutex_lock(&shard->lock);
+      for (int i = 0; i < STAT_COUNT; ++i) {
+        sum[i] += shard->stats[i];
+      }
+      (void)pthread_mutex_unlock(&shard->lock);
+    }
+  }
+
+  stats->hits = sum[STAT_HITS];
+  stats->misses = sum[STAT_MISSES];
+  stats->evictions = sum[STAT_EVICTIONS];
+  stats->writebacks = sum[STAT_WRITEBACKS];
+  stats->readahead = sum[STAT_READAHEAD];
+  stats->readahead_hits = sum[STAT_READAHEAD_HITS];
+  stats->readahead_wasted = sum[STAT_READAHEAD_WASTED];
+  stats->compressed = sum[STAT_COMPRESSED];
+  stats->compressed_hits = sum[STAT_COMPRESSED_HITS];
+  stats->mrc_step = 0;
+  stats->mrc_accesses = 0;
+  memset(stats->mrc_hits, 0, sizeof(stats->mrc_hits));
+  if (cache.mrc_state != NULL) {
+    mutex_lock(&cache.shared->mrc_lock);
+    vtpc_mrc_read(cache.mrc_state, stats);
+    (void)pthread_mutex_unlock(&cache.shared->mrc_lock);
+  }
+}
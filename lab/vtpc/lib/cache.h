@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "vtpc.h"
+
+#define VTPC_BLOCK_SIZE 4096
+#define VTPC_CAPACITY 256
+#define VTPC_MAX_FILES 1024
+
+// Sequential stream state of one handle, used to size readahead.
+struct vtpc_stream {
+  off_t next;       // offset right after the previous read
+  uint32_t window;  // readahead window in blocks, 0 while access is random
+  int advice;       // POSIX_FADV_NORMAL, _SEQUENTIAL, _RANDOM or _NOREUSE
+};
+
+int vtpc_cache_open(const char* path, int flags, mode_t mode);
+int vtpc_cache_close(int file);
+off_t vtpc_cache_size(int file);
+// The st_dev and st_ino of an open file.
+void vtpc_cache_identity(int file, uint64_t* dev, uint64_t* ino);
+// Reads up to `count` bytes into the segments of `iov`, which hold at least
+// that many.
+ssize_t vtpc_cache_readv(
+    int file,
+    const struct iovec* iov,
+    size_t count,
+    off_t offset,
+    struct vtpc_stream* stream
+);
+// As vtpc_cache_readv(), but blocks that are not cached are read from the
+// disk without caching them, and neither readahead nor the policy sees the
+// blocks that are.
+ssize_t vtpc_cache_read_direct(
+    int file, const struct iovec* iov, size_t count, off_t offset
+);
+// Pins the block holding `offset` in the cache and points `data` at it.
+// Returns the number of bytes available there, up to `count` and at most
+// to the end of the block, or 0 at end of file (nothing is pinned then).
+ssize_t vtpc_cache_pin(
+    int file,
+    off_t offset,
+    size_t count,
+    struct vtpc_stream* stream,
+    const void** data,
+    uint32_t* frame
+);
+void vtpc_cache_unpin(uint32_t frame);
+ssize_t vtpc_cache_writev(
+    int file, const struct iovec* iov, size_t count, off_t offset
+);
+int vtpc_cache_advice(int file, off_t offset, uint64_t hint);
+// Loads the blocks from `offset` to `offset + count` that are not cached
+// yet, like readahead and up to half the cache; on probation if `cold`.
+int vtpc_cache_prefetch(int file, off_t offset, size_t count, bool cold);
+// Evicts the blocks from `offset` to `offset + count` that are not in use,
+// writing dirty ones back first. With `wait`, waits for blocks busy with
+// I/O to evict them too, and writes back those views pin, which stay.
+int vtpc_cache_drop(int file, off_t offset, size_t count, bool wait);
+
+// Whether `file` was just opened afresh and has a manifest to be warmed up
+// from. True once per such open.
+bool vtpc_cache_warm_due(int file);
+// Returns the blocks the manifest of `file` lists, hottest first and no
+// more than the cache holds, to be freed by the caller; NULL if there is
+// none.
+uint64_t* vtpc_cache_manifest(int file, size_t* count);
+int vtpc_cache_sync(int file);
+
+// Sets the number of blocks the cache may use, up to the capacity it was
+// laid out for, and makes it the target of vtpc_cache_pressure().
+int vtpc_cache_resize(uint32_t capacity);
+// Shrinks the cache by a step while the system is short of memory (`high`),
+// else grows it back a step toward its target.
+void vtpc_cache_pressure(bool high);
+
+// Fills the event counters of `stats` for one file, or for the whole cache
+// when `file` is -1.
+void vtpc_cache_stats(int file, struct vtpc_stats* stats);
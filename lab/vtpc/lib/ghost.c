@@ -0,0 +1,144 @@
+#include "ghost.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+#include "policy.h"
+
+struct entry {
+  uint64_t key;
+  uint64_t value;
+  uint32_t hash_next;
+  int32_t list;
+};
+
+static uint32_t buckets_for(uint32_t capacity) {
+  uint32_t buckets = 1;
+  while (buckets < 2 * capacity) {
+    buckets <<= 1U;
+  }
+  return buckets;
+}
+
+static size_t links_offset(void) {
+  return VTPC_ALIGN(sizeof(struct vtpc_ghost));
+}
+
+static size_t entries_offset(uint32_t capacity) {
+  return links_offset() + VTPC_ALIGN(sizeof(struct vtpc_link) * capacity);
+}
+
+static size_t buckets_offset(uint32_t capacity) {
+  return entries_offset(capacity) + (sizeof(struct entry) * capacity);
+}
+
+static struct vtpc_link* links_of(const struct vtpc_ghost* ghost) {
+  return (struct vtpc_link*)((char*)ghost + links_offset());
+}
+
+static struct entry* entries_of(const struct vtpc_ghost* ghost) {
+  return (struct entry*)((char*)ghost + entries_offset(ghost->capacity));
+}
+
+static uint32_t* buckets_of(const struct vtpc_ghost* ghost) {
+  return (uint32_t*)((char*)ghost + buckets_offset(ghost->capacity));
+}
+
+static uint32_t* bucket(const struct vtpc_ghost* ghost, uint64_t key) {
+  uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+  return &buckets_of(ghost)[(uint32_t)(hash >> 32U) & ghost->mask];
+}
+
+size_t vtpc_ghost_footprint(uint32_t capacity) {
+  return buckets_offset(capacity) +
+         VTPC_ALIGN(sizeof(uint32_t) * buckets_for(capacity));
+}
+
+void vtpc_ghost_init(struct vtpc_ghost* ghost, uint32_t capacity) {
+  ghost->capacity = capacity;
+  ghost->mask = buckets_for(capacity) - 1;
+  for (int i = 0; i < VTPC_GHOST_LISTS; ++i) {
+    vtpc_list_init(&ghost->lists[i]);
+  }
+
+  struct vtpc_link* links = links_of(ghost);
+  for (uint32_t i = 0; i < capacity; ++i) {
+    links[i].next = (i + 1 < capacity) ? i + 1 : VTPC_NIL;
+  }
+  ghost->free = (capacity > 0) ? 0 : VTPC_NIL;
+
+  uint32_t* buckets = buckets_of(ghost);
+  for (uint32_t i = 0; i <= ghost->mask; ++i) {
+    buckets[i] = VTPC_NIL;
+  }
+}
+
+uint32_t vtpc_ghost_find(const struct vtpc_ghost* ghost, uint64_t key) {
+  const struct entry* entries = entries_of(ghost);
+  uint32_t idx = *bucket(ghost, key);
+  while (idx != VTPC_NIL && entries[idx].key != key) {
+    idx = entries[idx].hash_next;
+  }
+  return idx;
+}
+
+int vtpc_ghost_list(const struct vtpc_ghost* ghost, uint32_t entry) {
+  return entries_of(ghost)[entry].list;
+}
+
+uint64_t vtpc_ghost_value(const struct vtpc_ghost* ghost, uint32_t entry) {
+  return entries_of(ghost)[entry].value;
+}
+
+void vtpc_ghost_remove(struct vtpc_ghost* ghost, uint32_t entry) {
+  struct entry* entries = entries_of(ghost);
+  struct vtpc_link* links = links_of(ghost);
+
+  uint32_t* link = bucket(ghost, entries[entry].key);
+  while (*link != entry) {
+    link = &entries[*link].hash_next;
+  }
+  *link = entries[entry].hash_next;
+
+  vtpc_list_unlink(&ghost->lists[entries[entry].list], links, entry);
+  links[entry].next = ghost->free;
+  ghost->free = entry;
+}
+
+void vtpc_ghost_pop(struct vtpc_ghost* ghost, int list) {
+  uint32_t entry = ghost->lists[list].tail;
+  if (entry != VTPC_NIL) {
+    vtpc_ghost_remove(ghost, entry);
+  }
+}
+
+void vtpc_ghost_push(
+    struct vtpc_ghost* ghost, int list, uint64_t key, uint64_t value
+) {
+  if (ghost->capacity == 0) {
+    return;
+  }
+
+  uint32_t old = vtpc_ghost_find(ghost, key);
+  if (old != VTPC_NIL) {
+    vtpc_ghost_remove(ghost, old);
+  }
+  if (ghost->free == VTPC_NIL) {
+    int from = (ghost->lists[list].size > 0) ? list : 1 - list;
+    vtpc_ghost_pop(ghost, from);
+  }
+
+  struct entry* entries = entries_of(ghost);
+  struct vtpc_link* links = links_of(ghost);
+  uint32_t entry = ghost->free;
+  ghost->free = links[entry].next;
+
+  entries[entry].key = key;
+  entries[entry].value = value;
+  entries[entry].list = list;
+  uint32_t* head = bucket(ghost, key);
+  entries[entry].hash_next = *head;
+  *head = entry;
+  vtpc_list_push_front(&ghost->lists[list], links, entry);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+
+#define VTPC_GHOST_LISTS 2
+
+// Bounded set of keys of recently evicted blocks, kept in up to two LRU
+// lists and hashed for O(1) membership tests. Each entry carries one
+// policy-defined value. Lives in a single chunk of footprint() bytes.
+struct vtpc_ghost {
+  uint32_t capacity;
+  uint32_t mask;
+  uint32_t free;
+  struct vtpc_list lists[VTPC_GHOST_LISTS];
+};
+
+size_t vtpc_ghost_footprint(uint32_t capacity);
+void vtpc_ghost_init(struct vtpc_ghost* ghost, uint32_t capacity);
+
+// Returns the entry holding `key`, or VTPC_NIL.
+uint32_t vtpc_ghost_find(const struct vtpc_ghost* ghost, uint64_t key);
+int vtpc_ghost_list(const struct vtpc_ghost* ghost, uint32_t entry);
+uint64_t vtpc_ghost_value(const struct vtpc_ghost* ghost, uint32_t entry);
+
+// Remembers `key` as the most recent entry of `list`, forgetting the oldest
+// entry of that list (or of the other one) when the set is full.
+void vtpc_ghost_push(
+    struct vtpc_ghost* ghost, int list, uint64_t key, uint64_t value
+);
+void vtpc_ghost_remove(struct vtpc_ghost* ghost, uint32_t entry);
+// Forgets the oldest entry of `list`, if any.
+void vtpc_ghost_pop(struct vtpc_ghost* ghost, int list);
@@ -0,0 +1,156 @@
+#include "heap.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+#include "policy.h"
+
+static size_t keys_offset(void) {
+  return VTPC_ALIGN(sizeof(struct vtpc_heap));
+}
+
+static size_t items_offset(uint32_t capacity) {
+  return keys_offset() + (sizeof(uint64_t) * capacity);
+}
+
+static size_t pos_offset(uint32_t capacity) {
+  return items_offset(capacity) + (sizeof(uint32_t) * capacity);
+}
+
+static uint64_t* keys_of(const struct vtpc_heap* heap) {
+  return (uint64_t*)((char*)heap + keys_offset());
+}
+
+static uint32_t* items_of(const struct vtpc_heap* heap) {
+  return (uint32_t*)((char*)heap + items_offset(heap->capacity));
+}
+
+static uint32_t* pos_of(const struct vtpc_heap* heap) {
+  return (uint32_t*)((char*)heap + pos_offset(heap->capacity));
+}
+
+static void place(struct vtpc_heap* heap, uint32_t at, uint32_t item) {
+  items_of(heap)[at] = item;
+  pos_of(heap)[item] = at;
+}
+
+static void sift_up(struct vtpc_heap* heap, uint32_t at) {
+  const uint64_t* keys = keys_of(heap);
+  uint32_t* items = items_of(heap);
+  uint32_t item = items[at];
+  while (at > 0) {
+    uint32_t parent = (at - 1) / 2;
+    if (keys[items[parent]] <= keys[item]) {
+      break;
+    }
+    place(heap, at, items[parent]);
+    at = parent;
+  }
+  place(heap, at, item);
+}
+
+static void sift_down(struct vtpc_heap* heap, uint32_t at) {
+  const uint64_t* keys = keys_of(heap);
+  uint32_t* items = items_of(heap);
+  uint32_t item = items[at];
+  while (true) {
+    uint32_t child = (2 * at) + 1;
+    if (child >= heap->size) {
+      break;
+    }
+    if (child + 1 < heap->size &&
+        keys[items[child + 1]] < keys[items[child]]) {
+      ++child;
+    }
+    if (keys[item] <= keys[items[child]]) {
+      break;
+    }
+    place(heap, at, items[child]);
+    at = child;
+  }
+  place(heap, at, item);
+}
+
+size_t vtpc_heap_footprint(uint32_t capacity) {
+  return VTPC_ALIGN(pos_offset(capacity) + (sizeof(uint32_t) * capacity));
+}
+
+void vtpc_heap_init(struct vtpc_heap* heap, uint32_t capacity) {
+  heap->capacity = capacity;
+  heap->size = 0;
+  uint32_t* pos = pos_of(heap);
+  for (uint32_t i = 0; i < capacity; ++i) {
+    pos[i] = VTPC_NIL;
+  }
+}
+
+void vtpc_heap_set(struct vtpc_heap* heap, uint32_t item, uint64_t key) {
+  uint64_t* keys = keys_of(heap);
+  uint32_t at = pos_of(heap)[item];
+  if (at == VTPC_NIL) {
+    keys[item] = key;
+    at = heap->size++;
+    place(heap, at, item);
+    sift_up(heap, at);
+    return;
+  }
+
+  uint64_t old = keys[item];
+  keys[item] = key;
+  if (key < old) {
+    sift_up(heap, at);
+  } else {
+    sift_down(heap, at);
+  }
+}
+
+void vtpc_heap_remove(struct vtpc_heap* heap, uint32_t item) {
+  uint32_t* pos = pos_of(heap);
+  uint32_t at = pos[item];
+  if (at == VTPC_NIL) {
+    return;
+  }
+  pos[item] = VTPC_NIL;
+
+  uint32_t last = items_of(heap)[--heap->size];
+  if (at == heap->size) {
+    return;
+  }
+  place(heap, at, last);
+  sift_up(heap, at);
+  sift_down(heap, pos[last]);
+}
+
+uint32_t vtpc_heap_top(const struct vtpc_heap* heap) {
+  return (heap->size > 0) ? items_of(heap)[0] : VTPC_NIL;
+}
+
+uint64_t vtpc_heap_key(const struct vtpc_heap* heap, uint32_t item) {
+  return keys_of(heap)[item];
+}
+
+uint32_t vtpc_heap_pop_if(
+    struct vtpc_heap* heap,
+    uint32_t* scratch,
+    bool (*accept)(uint32_t item, void* arg),
+    void* arg
+) {
+  uint32_t skipped = 0;
+  uint32_t found = VTPC_NIL;
+  while (heap->size > 0) {
+    uint32_t item = items_of(heap)[0];
+    vtpc_heap_remove(heap, item);
+    if (accept(item, arg)) {
+      found = item;
+      break;
+    }
+    scratch[skipped++] = item;
+  }
+  // Rejected items keep their keys, so re-adding them restores the order.
+  for (uint32_t i = 0; i < skipped; ++i) {
+    vtpc_heap_set(heap, scratch[i], keys_of(heap)[scratch[i]]);
+  }
+  return found;
+}
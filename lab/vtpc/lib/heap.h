@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Indexed binary min-heap over items 0..capacity-1 with 64-bit keys, laid
+// out in a single chunk of footprint() bytes.
+struct vtpc_heap {
+  uint32_t capacity;
+  uint32_t size;
+};
+
+size_t vtpc_heap_footprint(uint32_t capacity);
+void vtpc_heap_init(struct vtpc_heap* heap, uint32_t capacity);
+
+// Inserts `item` or changes its key if it is already in the heap.
+void vtpc_heap_set(struct vtpc_heap* heap, uint32_t item, uint64_t key);
+void vtpc_heap_remove(struct vtpc_heap* heap, uint32_t item);
+// Returns the item with the smallest key, or VTPC_NIL.
+uint32_t vtpc_heap_top(const struct vtpc_heap* heap);
+uint64_t vtpc_heap_key(const struct vtpc_heap* heap, uint32_t item);
+
+// Removes and returns the item with the smallest key among those accepted
+// by `accept`, or VTPC_NIL. Rejected items are put back unchanged.
+uint32_t vtpc_heap_pop_if(
+    struct vtpc_heap* heap,
+    uint32_t* scratch,
+    bool (*accept)(uint32_t item, void* arg),
+    void* arg
+);
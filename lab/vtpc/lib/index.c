@@ -0,0 +1,188 @@
+#include "index.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+
+// Keys are stored plus one, so that a zeroed slot is empty.
+#define EMPTY 0U
+
+struct slot {
+  _Atomic uint32_t seq;  // odd while the slot is being rewritten
+  _Atomic uint32_t value;
+  _Atomic uint64_t key;
+};
+
+struct vtpc_index {
+  _Atomic uint32_t moves;  // odd while an erase shifts entries
+  uint32_t mask;
+  _Alignas(VTPC_INDEX_ALIGN) struct slot slots[];
+};
+
+_Static_assert(sizeof(struct slot) == 16, "four slots to a cache line");
+
+static uint32_t slots_for(uint32_t capacity) {
+  uint32_t slots = 4;
+  while (slots < 2 * capacity) {
+    slots <<= 1U;
+  }
+  return slots;
+}
+
+static uint32_t home_of(const struct vtpc_index* index, uint64_t stored) {
+  return (uint32_t)((stored * 0x9E3779B97F4A7C15ULL) >> 32U) & index->mask;
+}
+
+static void slot_read(const struct slot* slot, uint64_t* key, uint32_t* value) {
+  uint32_t seq = 0;
+  do {
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    *key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+    *value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+  } while ((seq & 1U) != 0 ||
+           seq != atomic_load_explicit(&slot->seq, memory_order_relaxed));
+}
+
+// Counters go from even to the next odd value and back, which also ends
+// an update that a dead writer left odd.
+static uint32_t odd_after(const _Atomic uint32_t* counter) {
+  return atomic_load_explicit(counter, memory_order_relaxed) | 1U;
+}
+
+static void slot_write(struct slot* slot, uint64_t key, uint32_t value) {
+  uint32_t seq = odd_after(&slot->seq);
+  atomic_store_explicit(&slot->seq, seq, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+  atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+  atomic_store_explicit(&slot->seq, seq + 1, memory_order_release);
+}
+
+// For those holding the lock of the writers, under whom no slot changes.
+static uint64_t slot_key(const struct slot* slot) {
+  return atomic_load_explicit(&slot->key, memory_order_relaxed);
+}
+
+size_t vtpc_index_footprint(uint32_t capacity) {
+  return sizeof(struct vtpc_index) +
+         ((size_t)slots_for(capacity) * sizeof(struct slot));
+}
+
+void vtpc_index_init(struct vtpc_index* index, uint32_t capacity) {
+  uint32_t slots = slots_for(capacity);
+  atomic_init(&index->moves, 0);
+  index->mask = slots - 1;
+  for (uint32_t i = 0; i < slots; ++i) {
+    atomic_init(&index->slots[i].seq, 0);
+    atomic_init(&index->slots[i].value, VTPC_NIL);
+    atomic_init(&index->slots[i].key, EMPTY);
+  }
+}
+
+uint32_t vtpc_index_find(const struct vtpc_index* index, uint64_t key) {
+  uint64_t stored = key + 1;
+  uint32_t pos = home_of(index, stored);
+  while (true) {
+    uint64_t found = slot_key(&index->slots[pos]);
+    if (found == stored) {
+      return atomic_load_explicit(
+          &index->slots[pos].value, memory_order_relaxed
+      );
+    }
+    if (found == EMPTY) {
+      return VTPC_NIL;
+    }
+    pos = (pos + 1) & index->mask;
+  }
+}
+
+uint32_t vtpc_index_find_unlocked(
+    const struct vtpc_index* index, uint64_t key
+) {
+  uint64_t stored = key + 1;
+  while (true) {
+    uint32_t moves = atomic_load_explicit(&index->moves, memory_order_acquire);
+    uint32_t pos = home_of(index, stored);
+    while (true) {
+      uint64_t found = EMPTY;
+      uint32_t value = VTPC_NIL;
+      slot_read(&index->slots[pos], &found, &value);
+      if (found == stored) {
+        return value;
+      }
+      if (found == EMPTY) {
+        break;
+      }
+      pos = (pos + 1) & index->mask;
+    }
+    // The key may have been shifted past this lookup meanwhile.
+    atomic_thread_fence(memory_order_acquire);
+    if ((moves & 1U) == 0 &&
+        atomic_load_explicit(&index->moves, memory_order_relaxed) == moves) {
+      return VTPC_NIL;
+    }
+  }
+}
+
+void vtpc_index_insert(struct vtpc_index* index, uint64_t key, uint32_t value) {
+  uint64_t stored = key + 1;
+  uint32_t pos = home_of(index, stored);
+  while (slot_key(&index->slots[pos]) != EMPTY) {
+    pos = (pos + 1) & index->mask;
+  }
+  slot_write(&index->slots[pos], stored, value);
+}
+
+void vtpc_index_erase(struct vtpc_index* index, uint64_t key) {
+  uint64_t stored = key + 1;
+  uint32_t hole = home_of(index, stored);
+  while (slot_key(&index->slots[hole]) != stored) {
+    if (slot_key(&index->slots[hole]) == EMPTY) {
+      return;
+    }
+    hole = (hole + 1) & index->mask;
+  }
+
+  // Moves back every later entry of the cluster whose probe sequence
+  // passes the hole, so that no lookup has to skip over it.
+  uint32_t moves = 0;
+  uint32_t pos = hole;
+  while (true) {
+    pos = (pos + 1) & index->mask;
+    uint64_t next = slot_key(&index->slots[pos]);
+    if (next == EMPTY) {
+      break;
+    }
+    uint32_t home = home_of(index, next);
+    if (((pos - home) & index->mask) < ((pos - hole) & index->mask)) {
+      continue;
+    }
+    if (moves == 0) {
+      moves = odd_after(&index->moves);
+      atomic_store_explicit(&index->moves, moves, memory_order_relaxed);
+      atomic_thread_fence(memory_order_release);
+    }
+    uint32_t value =
+        atomic_load_explicit(&index->slots[pos].value, memory_order_relaxed);
+    slot_write(&index->slots[hole], next, value);
+    hole = pos;
+  }
+  slot_write(&index->slots[hole], EMPTY, VTPC_NIL);
+  if (moves != 0) {
+    atomic_store_explicit(&index->moves, moves + 1, memory_order_release);
+  }
+}
+
+void vtpc_index_clear(struct vtpc_index* index) {
+  uint32_t moves = odd_after(&index->moves);
+  atomic_store_explicit(&index->moves, moves, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  for (uint32_t i = 0; i <= index->mask; ++i) {
+    slot_write(&index->slots[i], EMPTY, VTPC_NIL);
+  }
+  atomic_store_explicit(&index->moves, moves + 1, memory_order_release);
+}
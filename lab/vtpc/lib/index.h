@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VTPC_INDEX_ALIGN 64
+
+// Open-addressing hash table from 64-bit keys to 32-bit values, with linear
+// probing over 16-byte slots, four to a cache line. Lives in a single chunk
+// of footprint() bytes aligned to VTPC_INDEX_ALIGN that holds no pointers.
+//
+// Inserts and erases are serialized by a lock of the caller's. Lookups may
+// take that lock too, or none at all: every slot is a seqlock, and erases,
+// which shift later entries back into the hole, bump a table-wide counter
+// that lock-free lookups ending in a miss check.
+struct vtpc_index;
+
+size_t vtpc_index_footprint(uint32_t capacity);
+void vtpc_index_init(struct vtpc_index* index, uint32_t capacity);
+
+// Returns the value of `key`, or VTPC_NIL. Keys may be anything but
+// UINT64_MAX. The caller holds the lock of the writers.
+uint32_t vtpc_index_find(const struct vtpc_index* index, uint64_t key);
+
+// The same without any lock, alongside an insert or erase. The key may be
+// erased by the time this returns.
+uint32_t vtpc_index_find_unlocked(
+    const struct vtpc_index* index, uint64_t key
+);
+
+// Adds `key`, which must not be in the table. The table holds up to
+// `capacity` keys.
+void vtpc_index_insert(struct vtpc_index* index, uint64_t key, uint32_t value);
+void vtpc_index_erase(struct vtpc_index* index, uint64_t key);
+
+// Empties the table, even one a writer left halfway through an update when
+// its process died, while lock-free lookups may be running.
+void vtpc_index_clear(struct vtpc_index* index);
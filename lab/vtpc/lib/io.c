@@ -0,0 +1,334 @@
+#define _GNU_SOURCE
+#include "io.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+static void iov_advance(struct iovec** iov, int* count, size_t done) {
+  while (*count > 0 && done >= (*iov)->iov_len) {
+    done -= (*iov)->iov_len;
+    ++*iov;
+    --*count;
+  }
+  if (*count > 0) {
+    (*iov)->iov_base = (char*)(*iov)->iov_base + done;
+    (*iov)->iov_len -= done;
+  }
+}
+
+int vtpc_pwritev_all(int fd, struct iovec* iov, int count, off_t offset) {
+  while (count > 0) {
+    ssize_t done = pwritev(fd, iov, count, offset);
+    if (done == -1 && errno == EINTR) {
+      continue;
+    }
+    if (done == -1) {
+      return -1;
+    }
+    if (done == 0) {
+      errno = EIO;
+      return -1;
+    }
+    offset += done;
+    iov_advance(&iov, &count, (size_t)done);
+  }
+  return 0;
+}
+
+// Goes on with a read of which `total` bytes are in already.
+static ssize_t preadv_rest(
+    int fd, struct iovec* iov, int count, off_t offset, ssize_t total
+) {
+  while (count > 0) {
+    ssize_t done = preadv(fd, iov, count, offset);
+    if (done == -1 && errno == EINTR) {
+      continue;
+    }
+    if (done == -1 && errno == EINVAL && total > 0) {
+      // O_DIRECT refuses to go on from an unaligned offset, which is where
+      // a read stops short at EOF, should the file have grown since.
+      break;
+    }
+    if (done == -1) {
+      return -1;
+    }
+    if (done == 0) {
+      break;
+    }
+    total += done;
+    offset += done;
+    iov_advance(&iov, &count, (size_t)done);
+  }
+  return total;
+}
+
+ssize_t vtpc_preadv_all(int fd, struct iovec* iov, int count, off_t offset) {
+  return preadv_rest(fd, iov, count, offset, 0);
+}
+
+// Finishes a request synchronously, after `done` bytes of it went through
+// the ring.
+static void io_finish(struct vtpc_io* io, size_t done) {
+  iov_advance(&io->iov, &io->count, done);
+  off_t offset = io->offset + (off_t)done;
+  if (io->write) {
+    io->result = vtpc_pwritev_all(io->fd, io->iov, io->count, offset);
+  } else {
+    io->result =
+        preadv_rest(io->fd, io->iov, io->count, offset, (ssize_t)done);
+  }
+  io->error = (io->result == -1) ? errno : 0;
+}
+
+// The rings of a thread, mapped as the kernel laid them out.
+struct ring {
+  int fd;
+  unsigned* sq_tail;
+  const unsigned* sq_head;
+  unsigned sq_mask;
+  unsigned* sq_array;
+  struct io_uring_sqe* sqes;
+  unsigned* cq_head;
+  const unsigned* cq_tail;
+  unsigned cq_mask;
+  const struct io_uring_cqe* cqes;
+
+  void* sq_map;
+  size_t sq_size;
+  void* cq_map;
+  size_t cq_size;
+  size_t sqes_size;
+};
+
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static bool ring_disabled;
+
+static void ring_destroy(void* arg) {
+  struct ring* ring = arg;
+  (void)munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_map != ring->sq_map) {
+    (void)munmap(ring->cq_map, ring->cq_size);
+  }
+  (void)munmap(ring->sq_map, ring->sq_size);
+  (void)close(ring->fd);
+  free(ring);
+}
+
+static void ring_init_once(void) {
+  const char* text = getenv("VTPC_IO_URING");
+  ring_disabled = (text != NULL && strcmp(text, "0") == 0) ||
+                  pthread_key_create(&ring_key, ring_destroy) != 0;
+}
+
+static int ring_setup(struct ring* ring) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring->fd = (int)syscall(__NR_io_uring_setup, VTPC_IO_DEPTH, &params);
+  if (ring->fd == -1) {
+    return -1;
+  }
+
+  ring->sq_size = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+  ring->cq_size = params.cq_off.cqes +
+                  (params.cq_entries * sizeof(struct io_uring_cqe));
+  bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single && ring->cq_size > ring->sq_size) {
+    ring->sq_size = ring->cq_size;
+  }
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  int prot = PROT_READ | PROT_WRITE;
+  int flags = MAP_SHARED | MAP_POPULATE;
+  ring->sq_map =
+      mmap(NULL, ring->sq_size, prot, flags, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_map = single ? ring->sq_map
+                        : mmap(
+                              NULL,
+                              ring->cq_size,
+                              prot,
+                              flags,
+                              ring->fd,
+                              IORING_OFF_CQ_RING
+                          );
+  void* sqes =
+      mmap(NULL, ring->sqes_size, prot, flags, ring->fd, IORING_OFF_SQES);
+  if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED ||
+      sqes == MAP_FAILED) {
+    int err = errno;
+    if (sqes != MAP_FAILED) {
+      (void)munmap(sqes, ring->sqes_size);
+    }
+    if (ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map) {
+      (void)munmap(ring->cq_map, ring->cq_size);
+    }
+    if (ring->sq_map != MAP_FAILED) {
+      (void)munmap(ring->sq_map, ring->sq_size);
+    }
+    (void)close(ring->fd);
+    errno = err;
+    return -1;
+  }
+
+  char* sq = ring->sq_map;
+  char* cq = ring->cq_map;
+  ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+  ring->sq_head = (const unsigned*)(sq + params.sq_off.head);
+  ring->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+  ring->sqes = sqes;
+  ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+  ring->cq_tail = (const unsigned*)(cq + params.cq_off.tail);
+  ring->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+  ring->cqes = (const struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  return 0;
+}
+
+// Returns the ring of the calling thread, setting it up on first use, or
+// NULL when io_uring is not available.
+static struct ring* ring_get(void) {
+  (void)pthread_once(&ring_once, ring_init_once);
+  if (__atomic_load_n(&ring_disabled, __ATOMIC_RELAXED)) {
+    return NULL;
+  }
+  struct ring* ring = pthread_getspecific(ring_key);
+  if (ring != NULL) {
+    return ring;
+  }
+
+  ring = malloc(sizeof(*ring));
+  if (ring == NULL) {
+    return NULL;
+  }
+  if (ring_setup(ring) == -1) {
+    if (errno == ENOSYS || errno == EPERM) {
+      // Compiled out or forbidden by a seccomp policy: stop trying.
+      __atomic_store_n(&ring_disabled, true, __ATOMIC_RELAXED);
+    }
+    free(ring);
+    return NULL;
+  }
+  (void)pthread_setspecific(ring_key, ring);
+  return ring;
+}
+
+static void ring_push(struct ring* ring, const struct vtpc_io* io, int tag) {
+  unsigned tail = *ring->sq_tail;
+  unsigned slot = tail & ring->sq_mask;
+  struct io_uring_sqe* sqe = &ring->sqes[slot];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = io->write ? IORING_OP_WRITEV : IORING_OP_READV;
+  sqe->fd = io->fd;
+  sqe->addr = (uint64_t)(uintptr_t)io->iov;
+  sqe->len = (uint32_t)io->count;
+  sqe->off = (uint64_t)io->offset;
+  sqe->user_data = (uint64_t)tag;
+  ring->sq_array[slot] = slot;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static size_t io_size(const struct vtpc_io* io) {
+  size_t size = 0;
+  for (int i = 0; i < io->count; ++i) {
+    size += io->iov[i].iov_len;
+  }
+  return size;
+}
+
+static void ring_complete(struct vtpc_io* io, int res) {
+  if (res < 0) {
+    // Requests the kernel cannot take through the ring are retried the
+    // classic way, which also reports genuine errors.
+    io_finish(io, 0);
+  } else if ((size_t)res < io_size(io) && (io->write || res > 0)) {
+    io_finish(io, (size_t)res);
+  } else {
+    io->result = io->write ? 0 : res;
+    io->error = 0;
+  }
+}
+
+static unsigned ring_pending(const struct ring* ring) {
+  return *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+// Runs up to VTPC_IO_DEPTH requests through the ring and waits for all of
+// them. Returns -1 if the ring failed, in which case the requests it had
+// not taken yet were run the classic way.
+static int ring_run(struct ring* ring, struct vtpc_io* ios, int count) {
+  for (int i = 0; i < count; ++i) {
+    ring_push(ring, &ios[i], i);
+  }
+
+  int taken = count;  // requests the ring runs, the first ones pushed
+  int done = 0;
+  bool failed = false;
+  while (done < taken) {
+    long entered = syscall(
+        __NR_io_uring_enter,
+        ring->fd,
+        failed ? 0 : ring_pending(ring),
+        (unsigned)(taken - done),
+        IORING_ENTER_GETEVENTS,
+        NULL,
+        0
+    );
+    if (entered == -1 && errno != EINTR && errno != EAGAIN &&
+        errno != EBUSY) {
+      if (!failed) {
+        // Withdraw what was not taken; the rest is in flight and still
+        // points into the caller's memory, so it has to complete first.
+        unsigned pending = ring_pending(ring);
+        __atomic_store_n(
+            ring->sq_tail, *ring->sq_tail - pending, __ATOMIC_RELEASE
+        );
+        taken -= (int)pending;
+        failed = true;
+      } else {
+        // Not even waiting works: poll for the completions instead.
+        struct timespec pause = {0, 100000};
+        (void)nanosleep(&pause, NULL);
+      }
+    }
+
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head, ++done) {
+      const struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+      ring_complete(&ios[cqe->user_data], cqe->res);
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+  for (int i = taken; i < count; ++i) {
+    io_finish(&ios[i], 0);
+  }
+  return failed ? -1 : 0;
+}
+
+void vtpc_io_run(struct vtpc_io* ios, int count) {
+  struct ring* ring = (count > 0) ? ring_get() : NULL;
+  int i = 0;
+  while (ring != NULL && i < count) {
+    int batch = (count - i < VTPC_IO_DEPTH) ? count - i : VTPC_IO_DEPTH;
+    int result = ring_run(ring, ios + i, batch);
+    i += batch;
+    if (result == -1) {
+      break;
+    }
+  }
+  for (; i < count; ++i) {
+    io_finish(&ios[i], 0);
+  }
+}
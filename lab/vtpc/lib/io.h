@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Most requests vtpc_io_run() keeps in flight at once.
+#define VTPC_IO_DEPTH 64
+
+// Writes the whole vector, retrying on EINTR and short writes. `iov` is
+// consumed.
+int vtpc_pwritev_all(int fd, struct iovec* iov, int count, off_t offset);
+
+// Reads until the vector is full or EOF, retrying on EINTR and short reads.
+// Returns the number of bytes read, or -1. `iov` is consumed.
+ssize_t vtpc_preadv_all(int fd, struct iovec* iov, int count, off_t offset);
+
+// One vectored read or write. `iov` is consumed.
+struct vtpc_io {
+  int fd;
+  bool write;
+  struct iovec* iov;
+  int count;
+  off_t offset;
+  ssize_t result;  // bytes read (short only at EOF), 0 once written, or -1
+  int error;       // errno when `result` is -1
+};
+
+// Runs the requests and blocks until all of them have completed. Batches
+// go through a per-thread io_uring, one system call for up to
+// VTPC_IO_DEPTH requests, unless the kernel lacks it or VTPC_IO_URING=0;
+// then they fall back to preadv/pwritev one by one, as do the requests left
+// when the ring fails midway. Only the flush of dirty blocks hands over
+// more than one request at a time: readahead and the write-back of an
+// eviction victim are a single vectored run each. Completions are not
+// reaped later: the thread that starts a load owns its busy frames and
+// wakes their waiters when it is done, and a miss cannot return before its
+// data is in. Readahead goes in the same run as the miss that triggers it;
+// loading blocks in the background is left to vtpc_prefetch().
+void vtpc_io_run(struct vtpc_io* ios, int count);
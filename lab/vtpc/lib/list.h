@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+#define VTPC_NIL UINT32_MAX
+
+// Doubly linked list threaded through an array of links by index, so that
+// the same structure works wherever the array happens to be mapped.
+
+struct vtpc_link {
+  uint32_t prev;
+  uint32_t next;
+};
+
+struct vtpc_list {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t size;
+};
+
+static inline void vtpc_list_init(struct vtpc_list* list) {
+  list->head = VTPC_NIL;
+  list->tail = VTPC_NIL;
+  list->size = 0;
+}
+
+static inline void vtpc_list_push_front(
+    struct vtpc_list* list, struct vtpc_link* links, uint32_t idx
+) {
+  links[idx].prev = VTPC_NIL;
+  links[idx].next = list->head;
+  if (list->head != VTPC_NIL) {
+    links[list->head].prev = idx;
+  } else {
+    list->tail = idx;
+  }
+  list->head = idx;
+  ++list->size;
+}
+
+static inline void vtpc_list_push_back(
+    struct vtpc_list* list, struct vtpc_link* links, uint32_t idx
+) {
+  links[idx].prev = list->tail;
+  links[idx].next = VTPC_NIL;
+  if (list->tail != VTPC_NIL) {
+    links[list->tail].next = idx;
+  } else {
+    list->head = idx;
+  }
+  list->tail = idx;
+  ++list->size;
+}
+
+static inline void vtpc_list_unlink(
+    struct vtpc_list* list, struct vtpc_link* links, uint32_t idx
+) {
+  if (links[idx].prev != VTPC_NIL) {
+    links[links[idx].prev].next = links[idx].next;
+  } else {
+    list->head = links[idx].next;
+  }
+  if (links[idx].next != VTPC_NIL) {
+    links[links[idx].next].prev = links[idx].prev;
+  } else {
+    list->tail = links[idx].prev;
+  }
+  --list->size;
+}
+
+static inline uint32_t vtpc_list_pop_back(
+    struct vtpc_list* list, struct vtpc_link* links
+) {
+  uint32_t idx = list->tail;
+  if (idx != VTPC_NIL) {
+    vtpc_list_unlink(list, links, idx);
+  }
+  return idx;
+}
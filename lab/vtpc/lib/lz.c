@@ -0,0 +1,179 @@
+#include "lz.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH 4U
+#define LZ_MAX_OFFSET 65535U
+#define LZ_HASH_BITS 12U
+#define LZ_NIBBLE 15U
+
+static uint32_t load32(const uint8_t* at) {
+  uint32_t value = 0;
+  memcpy(&value, at, sizeof(value));
+  return value;
+}
+
+static uint32_t lz_hash(uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32U - LZ_HASH_BITS);
+}
+
+// Appends the part of a length that did not fit its nibble. Returns the
+// new output size, or 0 once past `cap`.
+static size_t put_length(uint8_t* out, size_t size, size_t cap, size_t rest) {
+  while (rest >= 255) {
+    if (size == cap) {
+      return 0;
+    }
+    out[size++] = 255;
+    rest -= 255;
+  }
+  if (size == cap) {
+    return 0;
+  }
+  out[size++] = (uint8_t)rest;
+  return size;
+}
+
+// Appends `literals` bytes from `from`, then a match of `match` bytes at
+// `offset` back unless `match` is 0. Returns the new output size, or 0 once
+// past `cap`.
+static size_t put_sequence(
+    uint8_t* out,
+    size_t size,
+    size_t cap,
+    const uint8_t* from,
+    size_t literals,
+    size_t offset,
+    size_t match
+) {
+  size_t extra = (match > 0) ? match - LZ_MIN_MATCH : 0;
+  if (size == cap) {
+    return 0;
+  }
+  size_t token = size++;
+  out[token] = (uint8_t)(((literals < LZ_NIBBLE) ? literals : LZ_NIBBLE) << 4U);
+  out[token] |= (uint8_t)((extra < LZ_NIBBLE) ? extra : LZ_NIBBLE);
+  if (literals >= LZ_NIBBLE) {
+    size = put_length(out, size, cap, literals - LZ_NIBBLE);
+    if (size == 0) {
+      return 0;
+    }
+  }
+  if (cap - size < literals) {
+    return 0;
+  }
+  memcpy(out + size, from, literals);
+  size += literals;
+  if (match == 0) {
+    return size;
+  }
+  if (cap - size < 2) {
+    return 0;
+  }
+  out[size++] = (uint8_t)(offset & 0xFFU);
+  out[size++] = (uint8_t)(offset >> 8U);
+  if (extra >= LZ_NIBBLE) {
+    size = put_length(out, size, cap, extra - LZ_NIBBLE);
+  }
+  return size;
+}
+
+size_t vtpc_lz_compress(
+    const uint8_t* in, size_t len, uint8_t* out, size_t cap
+) {
+  // Positions are remembered as offsets from `in`; stale or colliding ones
+  // are caught by comparing the bytes.
+  uint32_t table[1U << LZ_HASH_BITS];
+  memset(table, 0, sizeof(table));
+  size_t anchor = 0;
+  size_t pos = 0;
+  size_t size = 0;
+  while (pos + LZ_MIN_MATCH <= len) {
+    uint32_t sequence = load32(in + pos);
+    uint32_t* slot = &table[lz_hash(sequence)];
+    size_t candidate = *slot;
+    *slot = (uint32_t)pos;
+    if (candidate >= pos || pos - candidate > LZ_MAX_OFFSET ||
+        load32(in + candidate) != sequence) {
+      ++pos;
+      continue;
+    }
+    size_t match = LZ_MIN_MATCH;
+    while (pos + match < len && in[candidate + match] == in[pos + match]) {
+      ++match;
+    }
+    size = put_sequence(
+        out, size, cap, in + anchor, pos - anchor, pos - candidate, match
+    );
+    if (size == 0) {
+      return 0;
+    }
+    pos += match;
+    anchor = pos;
+  }
+  return put_sequence(out, size, cap, in + anchor, len - anchor, 0, 0);
+}
+
+// Reads the part of a length that did not fit its nibble. Returns -1 past
+// the end of the input.
+static int get_length(const uint8_t* in, size_t len, size_t* at, size_t* out) {
+  uint8_t byte = 0;
+  do {
+    if (*at == len) {
+      return -1;
+    }
+    byte = in[(*at)++];
+    *out += byte;
+  } while (byte == 255);
+  return 0;
+}
+
+int vtpc_lz_decompress(
+    const uint8_t* in, size_t len, uint8_t* out, size_t out_len
+) {
+  size_t at = 0;
+  size_t size = 0;
+  while (at < len) {
+    uint8_t token = in[at++];
+    size_t literals = token >> 4U;
+    if (literals == LZ_NIBBLE && get_length(in, len, &at, &literals) == -1) {
+      return -1;
+    }
+    if (literals > len - at || literals > out_len - size) {
+      return -1;
+    }
+    memcpy(out + size, in + at, literals);
+    at += literals;
+    size += literals;
+    if (at == len) {
+      break;  // the last sequence has no match
+    }
+
+    if (len - at < 2) {
+      return -1;
+    }
+    size_t offset = in[at] | ((size_t)in[at + 1] << 8U);
+    at += 2;
+    size_t match = token & LZ_NIBBLE;
+    if (match == LZ_NIBBLE && get_length(in, len, &at, &match) == -1) {
+      return -1;
+    }
+    match += LZ_MIN_MATCH;
+    if (offset == 0 || offset > size || match > out_len - size) {
+      return -1;
+    }
+    const uint8_t* from = out + size - offset;
+    if (offset >= match) {
+      memcpy(out + size, from, match);
+    } else {
+      // Byte by byte, as the match overlaps what it produces.
+      for (size_t i = 0; i < match; ++i) {
+        out[size + i] = from[i];
+      }
+    }
+    size += match;
+  }
+  return (size == out_len) ? 0 : -1;
+}
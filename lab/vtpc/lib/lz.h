@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A byte-oriented LZ77 codec in the manner of LZ4: sequences of literals
+// followed by a back reference of at least four bytes into the last 64 KiB.
+// Fast enough to run under a shard lock, if not the tightest.
+
+// Compresses `len` bytes of `in` into `out`. Returns the compressed size,
+// or 0 if it would exceed `cap`.
+size_t vtpc_lz_compress(
+    const uint8_t* in, size_t len, uint8_t* out, size_t cap
+);
+
+// Expands `len` bytes of `in` into exactly `out_len` bytes of `out`.
+// Returns -1 if the input is malformed or does not expand to that size.
+int vtpc_lz_decompress(
+    const uint8_t* in, size_t len, uint8_t* out, size_t out_len
+);
@@ -0,0 +1,124 @@
+#define _GNU_SOURCE
+#include "manifest.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "cache.h"
+
+#define MANIFEST_MAGIC 0x76747063686f7431ULL  // "vtpchot1"
+#define MANIFEST_MAX ((size_t)1 << 28U)       // blocks, 1 TiB worth
+
+struct manifest_header {
+  uint64_t magic;
+  uint32_t block_size;
+  uint32_t reserved;
+  uint64_t count;
+};
+
+static int write_all(int fd, const void* data, size_t size) {
+  const char* next = data;
+  while (size > 0) {
+    ssize_t done = write(fd, next, size);
+    if (done == -1 && errno == EINTR) {
+      continue;
+    }
+    if (done == -1) {
+      return -1;
+    }
+    next += done;
+    size -= (size_t)done;
+  }
+  return 0;
+}
+
+static int read_all(int fd, void* data, size_t size) {
+  char* next = data;
+  while (size > 0) {
+    ssize_t done = read(fd, next, size);
+    if (done == -1 && errno == EINTR) {
+      continue;
+    }
+    if (done == -1) {
+      return -1;
+    }
+    if (done == 0) {
+      errno = EINVAL;
+      return -1;
+    }
+    next += done;
+    size -= (size_t)done;
+  }
+  return 0;
+}
+
+int vtpc_manifest_write(
+    const char* path, const uint64_t* blocks, size_t count
+) {
+  // Processes closing the file at once each write their own copy.
+  char temp[PATH_MAX];
+  if (snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid()) >=
+      (int)sizeof(temp)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    return -1;
+  }
+  struct manifest_header header = {
+      .magic = MANIFEST_MAGIC,
+      .block_size = VTPC_BLOCK_SIZE,
+      .reserved = 0,
+      .count = count,
+  };
+  int result = write_all(fd, &header, sizeof(header));
+  if (result == 0) {
+    result = write_all(fd, blocks, count * sizeof(*blocks));
+  }
+  if (close(fd) == -1) {
+    result = -1;
+  }
+  if (result == 0) {
+    result = rename(temp, path);
+  }
+  if (result == -1) {
+    int err = errno;
+    (void)unlink(temp);
+    errno = err;
+  }
+  return result;
+}
+
+uint64_t* vtpc_manifest_read(const char* path, size_t* count) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return NULL;
+  }
+  struct manifest_header header;
+  uint64_t* blocks = NULL;
+  if (read_all(fd, &header, sizeof(header)) == 0) {
+    if (header.magic != MANIFEST_MAGIC ||
+        header.block_size != VTPC_BLOCK_SIZE || header.count > MANIFEST_MAX) {
+      errno = EINVAL;
+    } else {
+      blocks = malloc((header.count + 1) * sizeof(*blocks));
+    }
+  }
+  if (blocks != NULL &&
+      read_all(fd, blocks, header.count * sizeof(*blocks)) == -1) {
+    free(blocks);
+    blocks = NULL;
+  }
+  int err = errno;
+  (void)close(fd);
+  errno = err;
+  *count = (blocks != NULL) ? header.count : 0;
+  return blocks;
+}
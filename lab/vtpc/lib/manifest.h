@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A manifest lists blocks of a file, most recently used first, so that the
+// next process to open the file can load them before they are asked for.
+// It is a small binary file of native byte order next to the file itself.
+
+// Replaces the manifest at `path` in one step, so that readers never see
+// half of it.
+int vtpc_manifest_write(const char* path, const uint64_t* blocks, size_t count);
+
+// Returns the blocks listed at `path`, to be freed by the caller, or NULL
+// with errno set.
+uint64_t* vtpc_manifest_read(const char* path, size_t* count);
@@ -0,0 +1,193 @@
+#include "mrc.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "index.h"
+#include "list.h"
+#include "vtpc.h"
+
+// Keys hash to 24 bits; those below the threshold are sampled, at a rate
+// of at most one in MRC_RATE_MIN_DIV so that most accesses never take the
+// caller's lock.
+#define MRC_HASH_BITS 24U
+#define MRC_HASH_SPACE (1ULL << MRC_HASH_BITS)
+#define MRC_RATE_MIN_DIV 16U
+
+// Every sampled access gets the next time from a clock that runs up to
+// twice the sample size; when it gets there, the sampled blocks are
+// numbered anew in LRU order. A Fenwick tree over the times marks the
+// last access of each sampled block, so that the blocks accessed since
+// a given time are counted in O(log n).
+struct sample {
+  uint64_t key;
+  uint32_t time;
+};
+
+struct vtpc_mrc {
+  uint32_t samples;
+  uint32_t threshold;
+  uint32_t clock;
+  struct vtpc_list lru;  // sampled blocks, most recently used first
+  uint64_t step;
+  uint64_t accesses;                 // sampled ones
+  uint64_t reuses[VTPC_MRC_POINTS];  // by scaled distance over `step`
+};
+
+static size_t align_up(size_t size, size_t align) {
+  return (size + align - 1) & ~(align - 1);
+}
+
+static size_t index_offset(void) {
+  return align_up(sizeof(struct vtpc_mrc), VTPC_INDEX_ALIGN);
+}
+
+static size_t samples_offset(uint32_t samples) {
+  return align_up(
+      index_offset() + vtpc_index_footprint(samples), _Alignof(struct sample)
+  );
+}
+
+static size_t links_offset(uint32_t samples) {
+  return samples_offset(samples) + (samples * sizeof(struct sample));
+}
+
+static size_t tree_offset(uint32_t samples) {
+  return links_offset(samples) + (samples * sizeof(struct vtpc_link));
+}
+
+static struct vtpc_index* index_of(struct vtpc_mrc* mrc) {
+  return (struct vtpc_index*)((char*)mrc + index_offset());
+}
+
+static struct sample* samples_of(struct vtpc_mrc* mrc) {
+  return (struct sample*)((char*)mrc + samples_offset(mrc->samples));
+}
+
+static struct vtpc_link* links_of(struct vtpc_mrc* mrc) {
+  return (struct vtpc_link*)((char*)mrc + links_offset(mrc->samples));
+}
+
+// Indexed from 1 to twice the sample size.
+static uint32_t* tree_of(struct vtpc_mrc* mrc) {
+  return (uint32_t*)((char*)mrc + tree_offset(mrc->samples));
+}
+
+static uint32_t clock_end(const struct vtpc_mrc* mrc) {
+  return 2 * mrc->samples;
+}
+
+static void tree_add(struct vtpc_mrc* mrc, uint32_t time, int32_t delta) {
+  uint32_t* tree = tree_of(mrc);
+  for (uint32_t i = time; i <= clock_end(mrc); i += i & (0U - i)) {
+    tree[i] += (uint32_t)delta;
+  }
+}
+
+// Counts the marks up to `time`.
+static uint32_t tree_sum(struct vtpc_mrc* mrc, uint32_t time) {
+  const uint32_t* tree = tree_of(mrc);
+  uint32_t sum = 0;
+  for (uint32_t i = time; i > 0; i &= i - 1) {
+    sum += tree[i];
+  }
+  return sum;
+}
+
+static uint32_t hash_of(uint64_t key) {
+  key ^= key >> 33U;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33U;
+  key *= 0xC4CEB9FE1A85EC53ULL;
+  key ^= key >> 33U;
+  return (uint32_t)(key >> (64U - MRC_HASH_BITS));
+}
+
+// Numbers the sampled blocks from 1 on, oldest first.
+static void renumber(struct vtpc_mrc* mrc) {
+  struct sample* samples = samples_of(mrc);
+  const struct vtpc_link* links = links_of(mrc);
+  memset(tree_of(mrc), 0, (clock_end(mrc) + 1) * sizeof(uint32_t));
+  mrc->clock = 0;
+  for (uint32_t i = mrc->lru.tail; i != VTPC_NIL; i = links[i].prev) {
+    samples[i].time = ++mrc->clock;
+    tree_add(mrc, samples[i].time, 1);
+  }
+}
+
+size_t vtpc_mrc_footprint(uint32_t samples) {
+  return tree_offset(samples) + ((2 * (size_t)samples + 1) * sizeof(uint32_t));
+}
+
+void vtpc_mrc_init(struct vtpc_mrc* mrc, uint32_t samples, uint64_t span) {
+  memset(mrc, 0, sizeof(*mrc));
+  mrc->samples = samples;
+  uint64_t threshold = (MRC_HASH_SPACE * samples) / (span > 0 ? span : 1);
+  if (threshold > MRC_HASH_SPACE / MRC_RATE_MIN_DIV) {
+    threshold = MRC_HASH_SPACE / MRC_RATE_MIN_DIV;
+  }
+  mrc->threshold = (threshold > 0) ? (uint32_t)threshold : 1;
+  mrc->step = (span + VTPC_MRC_POINTS - 1) / VTPC_MRC_POINTS;
+  mrc->step = (mrc->step > 0) ? mrc->step : 1;
+  vtpc_mrc_restart(mrc);
+}
+
+bool vtpc_mrc_sampled(const struct vtpc_mrc* mrc, uint64_t key) {
+  return hash_of(key) < mrc->threshold;
+}
+
+void vtpc_mrc_access(struct vtpc_mrc* mrc, uint64_t key) {
+  struct sample* samples = samples_of(mrc);
+  struct vtpc_link* links = links_of(mrc);
+  ++mrc->accesses;
+
+  uint32_t idx = vtpc_index_find(index_of(mrc), key);
+  if (idx != VTPC_NIL) {
+    // Distinct sampled blocks accessed since, scaled to all blocks.
+    uint32_t distance =
+        tree_sum(mrc, mrc->clock) - tree_sum(mrc, samples[idx].time);
+    uint64_t bucket =
+        ((distance * MRC_HASH_SPACE) / mrc->threshold) / mrc->step;
+    if (bucket < VTPC_MRC_POINTS) {
+      ++mrc->reuses[bucket];
+    }
+    tree_add(mrc, samples[idx].time, -1);
+    vtpc_list_unlink(&mrc->lru, links, idx);
+  } else {
+    if (mrc->lru.size < mrc->samples) {
+      idx = mrc->lru.size;
+    } else {
+      idx = vtpc_list_pop_back(&mrc->lru, links);
+      tree_add(mrc, samples[idx].time, -1);
+      vtpc_index_erase(index_of(mrc), samples[idx].key);
+    }
+    samples[idx].key = key;
+    vtpc_index_insert(index_of(mrc), key, idx);
+  }
+
+  if (mrc->clock == clock_end(mrc)) {
+    renumber(mrc);
+  }
+  vtpc_list_push_front(&mrc->lru, links, idx);
+  samples[idx].time = ++mrc->clock;
+  tree_add(mrc, samples[idx].time, 1);
+}
+
+void vtpc_mrc_restart(struct vtpc_mrc* mrc) {
+  vtpc_list_init(&mrc->lru);
+  vtpc_index_init(index_of(mrc), mrc->samples);
+  renumber(mrc);
+}
+
+void vtpc_mrc_read(const struct vtpc_mrc* mrc, struct vtpc_stats* stats) {
+  double scale = (double)MRC_HASH_SPACE / (double)mrc->threshold;
+  stats->mrc_step = mrc->step;
+  stats->mrc_accesses = (uint64_t)((double)mrc->accesses * scale);
+  uint64_t hits = 0;
+  for (uint32_t i = 0; i < VTPC_MRC_POINTS; ++i) {
+    hits += mrc->reuses[i];
+    stats->mrc_hits[i] = (uint64_t)((double)hits * scale);
+  }
+}
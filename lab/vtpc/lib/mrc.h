@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vtpc.h"
+
+#define VTPC_MRC_ALIGN 64
+
+// Estimates the miss-ratio curve of an LRU cache from the reuse distances
+// of a spatially hashed sample of the blocks (SHARDS, Waldspurger et al.,
+// FAST '15): a block is in the sample if its key hashes below a threshold,
+// so every access to it is seen, and distances within the sample scale by
+// the sampling rate to those of all blocks. The rate is chosen so that
+// about `samples` sampled blocks span the curve; the sample keeps at most
+// that many, dropping the least recently used.
+//
+// The estimator is one caller-provided chunk of footprint() bytes aligned
+// to VTPC_MRC_ALIGN that holds no pointers. All calls but sampled() are
+// serialized by a lock of the caller's.
+struct vtpc_mrc;
+
+size_t vtpc_mrc_footprint(uint32_t samples);
+// Sets up a curve of VTPC_MRC_POINTS steps up to `span` blocks.
+void vtpc_mrc_init(struct vtpc_mrc* mrc, uint32_t samples, uint64_t span);
+
+// Whether accesses to `key` go to access(). Needs no lock.
+bool vtpc_mrc_sampled(const struct vtpc_mrc* mrc, uint64_t key);
+void vtpc_mrc_access(struct vtpc_mrc* mrc, uint64_t key);
+
+// Forgets the sampled blocks, e.g. after a writer died halfway through an
+// access, but keeps the curve measured so far.
+void vtpc_mrc_restart(struct vtpc_mrc* mrc);
+
+// Fills the mrc_* fields of `stats`, scaled up to all accesses.
+void vtpc_mrc_read(const struct vtpc_mrc* mrc, struct vtpc_stats* stats);
@@ -0,0 +1,25 @@
+#include "policy.h"
+
+#include <stddef.h>
+#include <strings.h>
+
+static const struct vtpc_policy* const policies[] = {
+    &vtpc_policy_lru,
+    &vtpc_policy_clock,
+    &vtpc_policy_2q,
+    &vtpc_policy_arc,
+    &vtpc_policy_lruk,
+    &vtpc_policy_opt,
+};
+
+const struct vtpc_policy* vtpc_policy_find(const char* name) {
+  if (name == NULL || *name == '\0') {
+    return &vtpc_policy_lru;
+  }
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); ++i) {
+    if (strcasecmp(name, policies[i]->name) == 0) {
+      return policies[i];
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+
+#define VTPC_ALIGN(size) (((size) + 7U) & ~(size_t)7U)
+
+// Tells the policy whether a frame may be evicted right now; frames with
+// I/O in flight may not.
+typedef bool (*vtpc_evictable_fn)(uint32_t frame, void* arg);
+
+// Block replacement policy. The policy state is one caller-provided chunk
+// of footprint(capacity) bytes that holds no pointers: frames are known by
+// their index in the pool and blocks by an opaque 64-bit key.
+struct vtpc_policy {
+  const char* name;
+  size_t (*footprint)(uint32_t capacity);
+  void (*init)(void* state, uint32_t capacity);
+  // A resident frame was accessed.
+  void (*hit)(void* state, uint32_t frame);
+  // Every frame is in use and `key` is about to be loaded: choose an
+  // evictable victim and stop tracking it. Returns VTPC_NIL if there is none.
+  uint32_t (*evict)(
+      void* state, uint64_t key, vtpc_evictable_fn evictable, void* arg
+  );
+  // `key` has been loaded into `frame`.
+  void (*insert)(void* state, uint32_t frame, uint64_t key);
+  // `frame` is dropped without eviction, e.g. because its file was closed.
+  void (*remove)(void* state, uint32_t frame);
+  // Optional: the next access to `key` is expected at `hint`. `frame` is
+  // VTPC_NIL when the block is not resident.
+  void (*advise)(void* state, uint32_t frame, uint64_t key, uint64_t hint);
+};
+
+extern const struct vtpc_policy vtpc_policy_lru;
+extern const struct vtpc_policy vtpc_policy_clock;
+extern const struct vtpc_policy vtpc_policy_2q;
+extern const struct vtpc_policy vtpc_policy_arc;
+extern const struct vtpc_policy vtpc_policy_lruk;
+extern const struct vtpc_policy vtpc_policy_opt;
+
+const struct vtpc_policy* vtpc_policy_find(const char* name);
+
+// Unlinks and returns the evictable frame closest to the tail of `list`.
+static inline uint32_t vtpc_policy_pop(
+    struct vtpc_list* list,
+    struct vtpc_link* links,
+    vtpc_evictable_fn evictable,
+    void* arg
+) {
+  for (uint32_t idx = list->tail; idx != VTPC_NIL; idx = links[idx].prev) {
+    if (evictable(idx, arg)) {
+      vtpc_list_unlink(list, links, idx);
+      return idx;
+    }
+  }
+  return VTPC_NIL;
+}
@@ -0,0 +1,151 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ghost.h"
+#include "list.h"
+#include "policy.h"
+
+enum {
+  NONE = 0,
+  AM = 1,    // LRU of blocks referenced again after admission
+  A1IN = 2,  // FIFO of blocks seen once
+};
+
+// Full 2Q (Johnson & Shasha): new blocks go through the A1in FIFO, and only
+// blocks that are referenced again while remembered in A1out get into Am.
+struct twoq {
+  uint32_t capacity;
+  uint32_t kin;
+  struct vtpc_list am;
+  struct vtpc_list a1in;
+};
+
+static size_t links_offset(void) {
+  return VTPC_ALIGN(sizeof(struct twoq));
+}
+
+static size_t keys_offset(uint32_t capacity) {
+  return links_offset() + VTPC_ALIGN(sizeof(struct vtpc_link) * capacity);
+}
+
+static size_t where_offset(uint32_t capacity) {
+  return keys_offset(capacity) + (sizeof(uint64_t) * capacity);
+}
+
+static size_t ghost_offset(uint32_t capacity) {
+  return where_offset(capacity) + VTPC_ALIGN(capacity);
+}
+
+static uint32_t kout_for(uint32_t capacity) {
+  return (capacity >= 2) ? capacity / 2 : 1;
+}
+
+static struct vtpc_link* links_of(struct twoq* q) {
+  return (struct vtpc_link*)((char*)q + links_offset());
+}
+
+static uint64_t* keys_of(struct twoq* q) {
+  return (uint64_t*)((char*)q + keys_offset(q->capacity));
+}
+
+static uint8_t* where_of(struct twoq* q) {
+  return (uint8_t*)q + where_offset(q->capacity);
+}
+
+static struct vtpc_ghost* ghost_of(struct twoq* q) {
+  return (struct vtpc_ghost*)((char*)q + ghost_offset(q->capacity));
+}
+
+static size_t twoq_footprint(uint32_t capacity) {
+  return ghost_offset(capacity) + vtpc_ghost_footprint(kout_for(capacity));
+}
+
+static void twoq_init(void* state, uint32_t capacity) {
+  struct twoq* q = state;
+  q->capacity = capacity;
+  q->kin = (capacity >= 4) ? capacity / 4 : 1;
+  vtpc_list_init(&q->am);
+  vtpc_list_init(&q->a1in);
+
+  uint8_t* where = where_of(q);
+  for (uint32_t i = 0; i < capacity; ++i) {
+    where[i] = NONE;
+  }
+  vtpc_ghost_init(ghost_of(q), kout_for(capacity));
+}
+
+static void twoq_hit(void* state, uint32_t frame) {
+  struct twoq* q = state;
+  if (where_of(q)[frame] == AM) {
+    vtpc_list_unlink(&q->am, links_of(q), frame);
+    vtpc_list_push_front(&q->am, links_of(q), frame);
+  }
+}
+
+static uint32_t twoq_evict(
+    void* state, uint64_t key, vtpc_evictable_fn evictable, void* arg
+) {
+  (void)key;
+  struct twoq* q = state;
+  struct vtpc_link* links = links_of(q);
+  bool from_a1in = q->a1in.size > q->kin || q->am.size == 0;
+
+  uint32_t frame = VTPC_NIL;
+  if (from_a1in) {
+    frame = vtpc_policy_pop(&q->a1in, links, evictable, arg);
+  }
+  if (frame == VTPC_NIL) {
+    frame = vtpc_policy_pop(&q->am, links, evictable, arg);
+    from_a1in = false;
+  }
+  if (frame == VTPC_NIL) {
+    frame = vtpc_policy_pop(&q->a1in, links, evictable, arg);
+    from_a1in = true;
+  }
+  if (frame == VTPC_NIL) {
+    return VTPC_NIL;
+  }
+
+  if (from_a1in) {
+    vtpc_ghost_push(ghost_of(q), 0, keys_of(q)[frame], 0);
+  }
+  where_of(q)[frame] = NONE;
+  return frame;
+}
+
+static void twoq_insert(void* state, uint32_t frame, uint64_t key) {
+  struct twoq* q = state;
+  keys_of(q)[frame] = key;
+
+  uint32_t entry = vtpc_ghost_find(ghost_of(q), key);
+  if (entry != VTPC_NIL) {
+    vtpc_ghost_remove(ghost_of(q), entry);
+    vtpc_list_push_front(&q->am, links_of(q), frame);
+    where_of(q)[frame] = AM;
+  } else {
+    vtpc_list_push_front(&q->a1in, links_of(q), frame);
+    where_of(q)[frame] = A1IN;
+  }
+}
+
+static void twoq_remove(void* state, uint32_t frame) {
+  struct twoq* q = state;
+  uint8_t* where = where_of(q);
+  if (where[frame] == AM) {
+    vtpc_list_unlink(&q->am, links_of(q), frame);
+  } else if (where[frame] == A1IN) {
+    vtpc_list_unlink(&q->a1in, links_of(q), frame);
+  }
+  where[frame] = NONE;
+}
+
+const struct vtpc_policy vtpc_policy_2q = {
+    .name = "2q",
+    .footprint = twoq_footprint,
+    .init = twoq_init,
+    .hit = twoq_hit,
+    .evict = twoq_evict,
+    .insert = twoq_insert,
+    .remove = twoq_remove,
+};
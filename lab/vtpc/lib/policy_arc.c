@@ -0,0 +1,184 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ghost.h"
+#include "list.h"
+#include "policy.h"
+
+enum {
+  NONE = 0,
+  T1 = 1,  // resident, seen once recently
+  T2 = 2,  // resident, seen at least twice recently
+};
+
+enum {
+  B1 = 0,  // ghosts evicted from T1
+  B2 = 1,  // ghosts evicted from T2
+};
+
+// Adaptive Replacement Cache (Megiddo & Modha). `p` is the target size of
+// T1 and moves towards whichever ghost list is getting hits.
+struct arc {
+  uint32_t capacity;
+  uint32_t p;
+  struct vtpc_list t1;
+  struct vtpc_list t2;
+  bool adapted;  // evict() already adapted `p` for `adapted_key`
+  uint64_t adapted_key;
+};
+
+static size_t links_offset(void) {
+  return VTPC_ALIGN(sizeof(struct arc));
+}
+
+static size_t keys_offset(uint32_t capacity) {
+  return links_offset() + VTPC_ALIGN(sizeof(struct vtpc_link) * capacity);
+}
+
+static size_t where_offset(uint32_t capacity) {
+  return keys_offset(capacity) + (sizeof(uint64_t) * capacity);
+}
+
+static size_t ghost_offset(uint32_t capacity) {
+  return where_offset(capacity) + VTPC_ALIGN(capacity);
+}
+
+static struct vtpc_link* links_of(struct arc* arc) {
+  return (struct vtpc_link*)((char*)arc + links_offset());
+}
+
+static uint64_t* keys_of(struct arc* arc) {
+  return (uint64_t*)((char*)arc + keys_offset(arc->capacity));
+}
+
+static uint8_t* where_of(struct arc* arc) {
+  return (uint8_t*)arc + where_offset(arc->capacity);
+}
+
+static struct vtpc_ghost* ghost_of(struct arc* arc) {
+  return (struct vtpc_ghost*)((char*)arc + ghost_offset(arc->capacity));
+}
+
+static void adapt(struct arc* arc, uint32_t entry) {
+  const struct vtpc_ghost* ghost = ghost_of(arc);
+  uint32_t b1 = ghost->lists[B1].size;
+  uint32_t b2 = ghost->lists[B2].size;
+
+  if (vtpc_ghost_list(ghost, entry) == B1) {
+    uint32_t delta = (b2 > b1) ? b2 / b1 : 1;
+    arc->p = (arc->p + delta < arc->capacity) ? arc->p + delta : arc->capacity;
+  } else {
+    uint32_t delta = (b1 > b2) ? b1 / b2 : 1;
+    arc->p = (arc->p > delta) ? arc->p - delta : 0;
+  }
+}
+
+static size_t arc_footprint(uint32_t capacity) {
+  return ghost_offset(capacity) + vtpc_ghost_footprint(capacity);
+}
+
+static void arc_init(void* state, uint32_t capacity) {
+  struct arc* arc = state;
+  arc->capacity = capacity;
+  arc->p = 0;
+  vtpc_list_init(&arc->t1);
+  vtpc_list_init(&arc->t2);
+  arc->adapted = false;
+
+  uint8_t* where = where_of(arc);
+  for (uint32_t i = 0; i < capacity; ++i) {
+    where[i] = NONE;
+  }
+  vtpc_ghost_init(ghost_of(arc), capacity);
+}
+
+static void arc_hit(void* state, uint32_t frame) {
+  struct arc* arc = state;
+  uint8_t* where = where_of(arc);
+  if (where[frame] == T1) {
+    vtpc_list_unlink(&arc->t1, links_of(arc), frame);
+  } else {
+    vtpc_list_unlink(&arc->t2, links_of(arc), frame);
+  }
+  vtpc_list_push_front(&arc->t2, links_of(arc), frame);
+  where[frame] = T2;
+}
+
+static uint32_t arc_evict(
+    void* state, uint64_t key, vtpc_evictable_fn evictable, void* arg
+) {
+  struct arc* arc = state;
+  struct vtpc_ghost* ghost = ghost_of(arc);
+
+  uint32_t entry = vtpc_ghost_find(ghost, key);
+  bool in_b2 = false;
+  if (entry != VTPC_NIL) {
+    adapt(arc, entry);
+    in_b2 = vtpc_ghost_list(ghost, entry) == B2;
+  }
+  arc->adapted = true;
+  arc->adapted_key = key;
+
+  uint32_t t1 = arc->t1.size;
+  bool from_t1 =
+      t1 > 0 && (t1 > arc->p || (in_b2 && t1 == arc->p) || arc->t2.size == 0);
+  struct vtpc_list* lists[2] = {&arc->t1, &arc->t2};
+  int first = from_t1 ? 0 : 1;
+
+  for (int i = 0; i < 2; ++i) {
+    int from = (first + i) % 2;
+    uint32_t frame =
+        vtpc_policy_pop(lists[from], links_of(arc), evictable, arg);
+    if (frame != VTPC_NIL) {
+      vtpc_ghost_push(ghost, (from == 0) ? B1 : B2, keys_of(arc)[frame], 0);
+      where_of(arc)[frame] = NONE;
+      return frame;
+    }
+  }
+  return VTPC_NIL;
+}
+
+static void arc_insert(void* state, uint32_t frame, uint64_t key) {
+  struct arc* arc = state;
+  struct vtpc_ghost* ghost = ghost_of(arc);
+  keys_of(arc)[frame] = key;
+
+  uint32_t entry = vtpc_ghost_find(ghost, key);
+  if (entry != VTPC_NIL) {
+    if (!arc->adapted || arc->adapted_key != key) {
+      adapt(arc, entry);
+    }
+    vtpc_ghost_remove(ghost, entry);
+    vtpc_list_push_front(&arc->t2, links_of(arc), frame);
+    where_of(arc)[frame] = T2;
+  } else {
+    if (arc->t1.size + ghost->lists[B1].size >= arc->capacity) {
+      vtpc_ghost_pop(ghost, B1);
+    }
+    vtpc_list_push_front(&arc->t1, links_of(arc), frame);
+    where_of(arc)[frame] = T1;
+  }
+  arc->adapted = false;
+}
+
+static void arc_remove(void* state, uint32_t frame) {
+  struct arc* arc = state;
+  uint8_t* where = where_of(arc);
+  if (where[frame] == T1) {
+    vtpc_list_unlink(&arc->t1, links_of(arc), frame);
+  } else if (where[frame] == T2) {
+    vtpc_list_unlink(&arc->t2, links_of(arc), frame);
+  }
+  where[frame] = NONE;
+}
+
+const struct vtpc_policy vtpc_policy_arc = {
+    .name = "arc",
+    .footprint = arc_footprint,
+    .init = arc_init,
+    .hit = arc_hit,
+    .evict = arc_evict,
+    .insert = arc_insert,
+    .remove = arc_remove,
+};
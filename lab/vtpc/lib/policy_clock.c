@@ -0,0 +1,81 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+#include "policy.h"
+
+enum {
+  EMPTY = 0,
+  RESIDENT = 1,
+  REFERENCED = 2,
+};
+
+// Second chance: a hand sweeps the frames in a circle, clearing reference
+// bits, and evicts the first resident frame that has none.
+struct clock {
+  uint32_t capacity;
+  uint32_t hand;
+  uint8_t state[];
+};
+
+static size_t clock_footprint(uint32_t capacity) {
+  return VTPC_ALIGN(sizeof(struct clock) + capacity);
+}
+
+static void clock_init(void* state, uint32_t capacity) {
+  struct clock* clock = state;
+  clock->capacity = capacity;
+  clock->hand = 0;
+  for (uint32_t i = 0; i < capacity; ++i) {
+    clock->state[i] = EMPTY;
+  }
+}
+
+static void clock_hit(void* state, uint32_t frame) {
+  struct clock* clock = state;
+  clock->state[frame] = REFERENCED;
+}
+
+static uint32_t clock_evict(
+    void* state, uint64_t key, vtpc_evictable_fn evictable, void* arg
+) {
+  (void)key;
+  struct clock* clock = state;
+  // Two full turns clear every reference bit, so a victim is found unless
+  // every resident frame is busy.
+  for (uint32_t step = 0; step < 2 * clock->capacity; ++step) {
+    uint32_t frame = clock->hand;
+    clock->hand = (clock->hand + 1) % clock->capacity;
+    if (clock->state[frame] == EMPTY || !evictable(frame, arg)) {
+      continue;
+    }
+    if (clock->state[frame] == REFERENCED) {
+      clock->state[frame] = RESIDENT;
+    } else if (clock->state[frame] == RESIDENT) {
+      clock->state[frame] = EMPTY;
+      return frame;
+    }
+  }
+  return VTPC_NIL;
+}
+
+static void clock_insert(void* state, uint32_t frame, uint64_t key) {
+  (void)key;
+  struct clock* clock = state;
+  clock->state[frame] = REFERENCED;
+}
+
+static void clock_remove(void* state, uint32_t frame) {
+  struct clock* clock = state;
+  clock->state[frame] = EMPTY;
+}
+
+const struct vtpc_policy vtpc_policy_clock = {
+    .name = "clock",
+    .footprint = clock_footprint,
+    .init = clock_init,
+    .hit = clock_hit,
+    .evict = clock_evict,
+    .insert = clock_insert,
+    .remove = clock_remove,
+};
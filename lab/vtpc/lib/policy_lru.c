@@ -0,0 +1,57 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+#include "policy.h"
+
+struct lru {
+  struct vtpc_list list;  // most recently used first
+  struct vtpc_link links[];
+};
+
+static size_t lru_footprint(uint32_t capacity) {
+  return VTPC_ALIGN(
+      sizeof(struct lru) + (sizeof(struct vtpc_link) * capacity)
+  );
+}
+
+static void lru_init(void* state, uint32_t capacity) {
+  (void)capacity;
+  struct lru* lru = state;
+  vtpc_list_init(&lru->list);
+}
+
+static void lru_hit(void* state, uint32_t frame) {
+  struct lru* lru = state;
+  vtpc_list_unlink(&lru->list, lru->links, frame);
+  vtpc_list_push_front(&lru->list, lru->links, frame);
+}
+
+static uint32_t lru_evict(
+    void* state, uint64_t key, vtpc_evictable_fn evictable, void* arg
+) {
+  (void)key;
+  struct lru* lru = state;
+  return vtpc_policy_pop(&lru->list, lru->links, evictable, arg);
+}
+
+static void lru_insert(void* state, uint32_t frame, uint64_t key) {
+  (void)key;
+  struct lru* lru = state;
+  vtpc_list_push_front(&lru->list, lru->links, frame);
+}
+
+static void lru_remove(void* state, uint32_t frame) {
+  struct lru* lru = state;
+  vtpc_list_unlink(&lru->list, lru->links, frame);
+}
+
+const struct vtpc_policy vtpc_policy_lru = {
+    .name = "lru",
+    .footprint = lru_footprint,
+    .init = lru_init,
+    .hit = lru_hit,
+    .evict = lru_evict,
+    .insert = lru_insert,
+    .remove = lru_remove,
+};
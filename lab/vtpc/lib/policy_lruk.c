@@ -0,0 +1,134 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ghost.h"
+#include "heap.h"
+#include "list.h"
+#include "policy.h"
+
+#define FULL_HISTORY (1ULL << 63U)
+
+// LRU-K with K = 2 (O'Neil et al.): evicts the block whose second most
+// recent reference is the oldest. Blocks referenced only once have an
+// infinite backward distance and go first, in LRU order. Evicted blocks
+// keep their last reference time in a ghost history so that a quick return
+// counts as a second reference. Exact backward-distance order cannot be
+// kept in O(1): a hit moves a block's second reference to its old last one,
+// which may fall anywhere among the others, so no list appended to at one
+// end stays sorted. Victims come from an O(log n) heap instead.
+struct lruk {
+  uint32_t capacity;
+  uint64_t now;
+};
+
+struct history {
+  uint64_t key;
+  uint64_t last;
+  uint64_t prev;  // 0 if the block was referenced only once
+};
+
+static size_t history_offset(void) {
+  return VTPC_ALIGN(sizeof(struct lruk));
+}
+
+static size_t heap_offset(uint32_t capacity) {
+  return history_offset() + (sizeof(struct history) * capacity);
+}
+
+static size_t scratch_offset(uint32_t capacity) {
+  return heap_offset(capacity) + vtpc_heap_footprint(capacity);
+}
+
+static size_t ghost_offset(uint32_t capacity) {
+  return scratch_offset(capacity) +
+         VTPC_ALIGN(sizeof(uint32_t) * capacity);
+}
+
+static struct history* history_of(struct lruk* lruk) {
+  return (struct history*)((char*)lruk + history_offset());
+}
+
+static struct vtpc_heap* heap_of(struct lruk* lruk) {
+  return (struct vtpc_heap*)((char*)lruk + heap_offset(lruk->capacity));
+}
+
+static uint32_t* scratch_of(struct lruk* lruk) {
+  return (uint32_t*)((char*)lruk + scratch_offset(lruk->capacity));
+}
+
+static struct vtpc_ghost* ghost_of(struct lruk* lruk) {
+  return (struct vtpc_ghost*)((char*)lruk + ghost_offset(lruk->capacity));
+}
+
+static void reorder(struct lruk* lruk, uint32_t frame) {
+  const struct history* history = &history_of(lruk)[frame];
+  uint64_t rank =
+      (history->prev == 0) ? history->last : (FULL_HISTORY | history->prev);
+  vtpc_heap_set(heap_of(lruk), frame, rank);
+}
+
+static size_t lruk_footprint(uint32_t capacity) {
+  return ghost_offset(capacity) + vtpc_ghost_footprint(capacity);
+}
+
+static void lruk_init(void* state, uint32_t capacity) {
+  struct lruk* lruk = state;
+  lruk->capacity = capacity;
+  lruk->now = 0;
+  vtpc_heap_init(heap_of(lruk), capacity);
+  vtpc_ghost_init(ghost_of(lruk), capacity);
+}
+
+static void lruk_hit(void* state, uint32_t frame) {
+  struct lruk* lruk = state;
+  struct history* history = &history_of(lruk)[frame];
+  history->prev = history->last;
+  history->last = ++lruk->now;
+  reorder(lruk, frame);
+}
+
+static uint32_t lruk_evict(
+    void* state, uint64_t key, vtpc_evictable_fn evictable, void* arg
+) {
+  (void)key;
+  struct lruk* lruk = state;
+  uint32_t frame =
+      vtpc_heap_pop_if(heap_of(lruk), scratch_of(lruk), evictable, arg);
+  if (frame == VTPC_NIL) {
+    return VTPC_NIL;
+  }
+
+  const struct history* history = &history_of(lruk)[frame];
+  vtpc_ghost_push(ghost_of(lruk), 0, history->key, history->last);
+  return frame;
+}
+
+static void lruk_insert(void* state, uint32_t frame, uint64_t key) {
+  struct lruk* lruk = state;
+  struct history* history = &history_of(lruk)[frame];
+  history->key = key;
+  history->prev = 0;
+  history->last = ++lruk->now;
+
+  uint32_t entry = vtpc_ghost_find(ghost_of(lruk), key);
+  if (entry != VTPC_NIL) {
+    history->prev = vtpc_ghost_value(ghost_of(lruk), entry);
+    vtpc_ghost_remove(ghost_of(lruk), entry);
+  }
+  reorder(lruk, frame);
+}
+
+static void lruk_remove(void* state, uint32_t frame) {
+  struct lruk* lruk = state;
+  vtpc_heap_remove(heap_of(lruk), frame);
+}
+
+const struct vtpc_policy vtpc_policy_lruk = {
+    .name = "lru-k",
+    .footprint = lruk_footprint,
+    .init = lruk_init,
+    .hit = lruk_hit,
+    .evict = lruk_evict,
+    .insert = lruk_insert,
+    .remove = lruk_remove,
+};
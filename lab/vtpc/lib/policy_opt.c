@@ -0,0 +1,116 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ghost.h"
+#include "heap.h"
+#include "list.h"
+#include "policy.h"
+
+#define HINTED (1ULL << 63U)
+
+// Belady's optimal replacement driven by vtpc_advice: evicts the block
+// whose next access is the furthest away. A hint covers the next access
+// to its block only. Blocks without a hint are treated as never used again
+// and go first, in LRU order. Hints given for blocks that are not resident
+// yet wait in a bounded side table until the block is loaded.
+struct opt {
+  uint32_t capacity;
+  uint64_t now;
+};
+
+static size_t heap_offset(void) {
+  return VTPC_ALIGN(sizeof(struct opt));
+}
+
+static size_t scratch_offset(uint32_t capacity) {
+  return heap_offset() + vtpc_heap_footprint(capacity);
+}
+
+static size_t pending_offset(uint32_t capacity) {
+  return scratch_offset(capacity) + VTPC_ALIGN(sizeof(uint32_t) * capacity);
+}
+
+static struct vtpc_heap* heap_of(struct opt* opt) {
+  return (struct vtpc_heap*)((char*)opt + heap_offset());
+}
+
+static uint32_t* scratch_of(struct opt* opt) {
+  return (uint32_t*)((char*)opt + scratch_offset(opt->capacity));
+}
+
+static struct vtpc_ghost* pending_of(struct opt* opt) {
+  return (struct vtpc_ghost*)((char*)opt + pending_offset(opt->capacity));
+}
+
+// The heap pops the smallest rank: unhinted blocks by age first, then
+// hinted blocks from the latest next access to the earliest.
+static void rank_unhinted(struct opt* opt, uint32_t frame) {
+  vtpc_heap_set(heap_of(opt), frame, ++opt->now);
+}
+
+static void rank_hinted(struct opt* opt, uint32_t frame, uint64_t hint) {
+  vtpc_heap_set(heap_of(opt), frame, HINTED | (~hint & ~HINTED));
+}
+
+static size_t opt_footprint(uint32_t capacity) {
+  return pending_offset(capacity) + vtpc_ghost_footprint(capacity);
+}
+
+static void opt_init(void* state, uint32_t capacity) {
+  struct opt* opt = state;
+  opt->capacity = capacity;
+  opt->now = 0;
+  vtpc_heap_init(heap_of(opt), capacity);
+  vtpc_ghost_init(pending_of(opt), capacity);
+}
+
+static void opt_hit(void* state, uint32_t frame) {
+  rank_unhinted(state, frame);
+}
+
+static uint32_t opt_evict(
+    void* state, uint64_t key, vtpc_evictable_fn evictable, void* arg
+) {
+  (void)key;
+  struct opt* opt = state;
+  return vtpc_heap_pop_if(heap_of(opt), scratch_of(opt), evictable, arg);
+}
+
+static void opt_insert(void* state, uint32_t frame, uint64_t key) {
+  struct opt* opt = state;
+  struct vtpc_ghost* pending = pending_of(opt);
+  uint32_t entry = vtpc_ghost_find(pending, key);
+  if (entry == VTPC_NIL) {
+    rank_unhinted(opt, frame);
+    return;
+  }
+  rank_hinted(opt, frame, vtpc_ghost_value(pending, entry));
+  vtpc_ghost_remove(pending, entry);
+}
+
+static void opt_remove(void* state, uint32_t frame) {
+  struct opt* opt = state;
+  vtpc_heap_remove(heap_of(opt), frame);
+}
+
+static void opt_advise(
+    void* state, uint32_t frame, uint64_t key, uint64_t hint
+) {
+  struct opt* opt = state;
+  if (frame != VTPC_NIL) {
+    rank_hinted(opt, frame, hint);
+  } else {
+    vtpc_ghost_push(pending_of(opt), 0, key, hint);
+  }
+}
+
+const struct vtpc_policy vtpc_policy_opt = {
+    .name = "opt",
+    .footprint = opt_footprint,
+    .init = opt_init,
+    .hit = opt_hit,
+    .evict = opt_evict,
+    .insert = opt_insert,
+    .remove = opt_remove,
+    .advise = opt_advise,
+};
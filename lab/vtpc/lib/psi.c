@@ -0,0 +1,59 @@
+#define _GNU_SOURCE
+#include "psi.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "cache.h"
+
+#define PSI_PATH "/proc/pressure/memory"
+
+static void* psi_main(void* arg) {
+  struct pollfd trigger = {.fd = (int)(intptr_t)arg, .events = POLLPRI};
+  while (true) {
+    int ready = poll(&trigger, 1, VTPC_PSI_QUIET_MS);
+    if (ready == -1 && errno == EINTR) {
+      continue;
+    }
+    if (ready == -1 || (trigger.revents & POLLERR) != 0) {
+      break;  // the trigger went away with its cgroup
+    }
+    vtpc_cache_pressure(ready > 0);
+  }
+  (void)close(trigger.fd);
+  return NULL;
+}
+
+int vtpc_psi_start(uint32_t stall_us) {
+  int fd = open(PSI_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd == -1) {
+    return -1;
+  }
+  char trigger[64];
+  int len = snprintf(
+      trigger, sizeof(trigger), "some %u %u", stall_us, VTPC_PSI_WINDOW_US
+  );
+  // The kernel wants the terminating NUL too.
+  if (write(fd, trigger, (size_t)len + 1) == -1) {
+    int err = errno;
+    (void)close(fd);
+    errno = err;
+    return -1;
+  }
+
+  pthread_t thread;
+  int result = pthread_create(&thread, NULL, psi_main, (void*)(intptr_t)fd);
+  if (result != 0) {
+    (void)close(fd);
+    errno = result;
+    return -1;
+  }
+  (void)pthread_detach(thread);
+  return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+// Window over which the kernel measures memory stalls for the monitor.
+// Unprivileged processes may only ask for multiples of 2 s.
+#define VTPC_PSI_WINDOW_US 2000000U
+// Quiet time after which the cache takes a step back toward its target.
+#define VTPC_PSI_QUIET_MS 10000
+
+// Starts a thread that watches /proc/pressure/memory and calls
+// vtpc_cache_pressure(true) whenever tasks stalled on memory for more than
+// `stall_us` within a window, and vtpc_cache_pressure(false) after every
+// VTPC_PSI_QUIET_MS without that. Returns -1 with errno set if the kernel
+// does not track pressure.
+int vtpc_psi_start(uint32_t stall_us);
@@ -0,0 +1,136 @@
+#include "stats.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "vtpc.h"
+
+uint64_t vtpc_clock_ns(void) {
+  struct timespec now;
+  (void)clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+}
+
+static int bucket_of(uint64_t ns) {
+  int bucket = 63 - __builtin_clzll(ns | 1U);
+  return (bucket < VTPC_LATENCY_BUCKETS) ? bucket : VTPC_LATENCY_BUCKETS - 1;
+}
+
+void vtpc_latency_add(struct vtpc_latency* latency, uint64_t start) {
+  uint64_t ns = vtpc_clock_ns() - start;
+  (void)__atomic_fetch_add(&latency->count, 1, __ATOMIC_RELAXED);
+  (void)__atomic_fetch_add(&latency->total_ns, ns, __ATOMIC_RELAXED);
+  (void)__atomic_fetch_add(
+      &latency->buckets[bucket_of(ns)], 1, __ATOMIC_RELAXED
+  );
+}
+
+void vtpc_latency_load(
+    const struct vtpc_latency* latency, struct vtpc_latency* out
+) {
+  out->count = __atomic_load_n(&latency->count, __ATOMIC_RELAXED);
+  out->total_ns = __atomic_load_n(&latency->total_ns, __ATOMIC_RELAXED);
+  for (int i = 0; i < VTPC_LATENCY_BUCKETS; ++i) {
+    out->buckets[i] = __atomic_load_n(&latency->buckets[i], __ATOMIC_RELAXED);
+  }
+}
+
+struct json {
+  char text[8192];
+  size_t size;
+};
+
+__attribute__((format(printf, 2, 3))) static void json_append(
+    struct json* json, const char* format, ...
+) {
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(
+      json->text + json->size, sizeof(json->text) - json->size, format, args
+  );
+  va_end(args);
+  if (n > 0) {
+    json->size += (size_t)n;
+  }
+  if (json->size >= sizeof(json->text)) {
+    json->size = sizeof(json->text) - 1;
+  }
+}
+
+static void json_latency(
+    struct json* json, const char* key, const struct vtpc_latency* latency
+) {
+  json_append(
+      json,
+      ",\"%s\":{\"count\":%llu,\"total_ns\":%llu,\"buckets\":[",
+      key,
+      (unsigned long long)latency->count,
+      (unsigned long long)latency->total_ns
+  );
+  for (int i = 0; i < VTPC_LATENCY_BUCKETS; ++i) {
+    json_append(
+        json,
+        "%s%llu",
+        (i == 0) ? "" : ",",
+        (unsigned long long)latency->buckets[i]
+    );
+  }
+  json_append(json, "]}");
+}
+
+int vtpc_stats_write_json(int fd, const struct vtpc_stats* stats) {
+  struct json json = {.size = 0};
+  json_append(
+      &json,
+      "{\"hits\":%llu,\"misses\":%llu,\"evictions\":%llu,"
+      "\"writebacks\":%llu,\"readahead\":%llu,\"readahead_hits\":%llu,"
+      "\"readahead_wasted\":%llu,\"compressed\":%llu,"
+      "\"compressed_hits\":%llu",
+      (unsigned long long)stats->hits,
+      (unsigned long long)stats->misses,
+      (unsigned long long)stats->evictions,
+      (unsigned long long)stats->writebacks,
+      (unsigned long long)stats->readahead,
+      (unsigned long long)stats->readahead_hits,
+      (unsigned long long)stats->readahead_wasted,
+      (unsigned long long)stats->compressed,
+      (unsigned long long)stats->compressed_hits
+  );
+  json_append(
+      &json,
+      ",\"mrc\":{\"step\":%llu,\"accesses\":%llu,\"hits\":[",
+      (unsigned long long)stats->mrc_step,
+      (unsigned long long)stats->mrc_accesses
+  );
+  for (int i = 0; i < VTPC_MRC_POINTS; ++i) {
+    json_append(
+        &json,
+        "%s%llu",
+        (i == 0) ? "" : ",",
+        (unsigned long long)stats->mrc_hits[i]
+    );
+  }
+  json_append(&json, "]}");
+  json_latency(&json, "read", &stats->read);
+  json_latency(&json, "write", &stats->write);
+  json_latency(&json, "fsync", &stats->fsync);
+  json_append(&json, "}\n");
+
+  size_t done = 0;
+  while (done < json.size) {
+    ssize_t n = write(fd, json.text + done, json.size - done);
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1) {
+      return -1;
+    }
+    done += (size_t)n;
+  }
+  return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "vtpc.h"
+
+uint64_t vtpc_clock_ns(void);
+
+// Records a call that started at `start`, as given by vtpc_clock_ns(). Safe
+// to call concurrently with itself and with vtpc_latency_load().
+void vtpc_latency_add(struct vtpc_latency* latency, uint64_t start);
+void vtpc_latency_load(
+    const struct vtpc_latency* latency, struct vtpc_latency* out
+);
+
+// Writes `stats` to `fd` as a single JSON object.
+int vtpc_stats_write_json(int fd, const struct vtpc_stats* stats);
@@ -0,0 +1,107 @@
+#define _GNU_SOURCE
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/file.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "stats.h"
+
+#define TRACE_CHUNK 256  // records
+
+_Static_assert(sizeof(struct vtpc_trace_record) == 48, "no padding");
+
+// Records are gathered into a chunk that goes out in a single append, so
+// that those of other processes do not split it.
+static struct {
+  pthread_mutex_t lock;
+  int fd;  // -1 unless tracing, set once before any call is recorded
+  uint32_t count;
+  struct vtpc_trace_record chunk[TRACE_CHUNK];
+} trace = {.lock = PTHREAD_MUTEX_INITIALIZER, .fd = -1};
+
+static void write_all(int fd, const void* data, size_t size) {
+  const char* next = data;
+  while (size > 0) {
+    ssize_t done = write(fd, next, size);
+    if (done == -1 && errno == EINTR) {
+      continue;
+    }
+    if (done == -1) {
+      return;  // a trace is best effort
+    }
+    next += done;
+    size -= (size_t)done;
+  }
+}
+
+// Writes out the chunk; the trace lock is held.
+static void trace_flush(void) {
+  write_all(trace.fd, trace.chunk, trace.count * sizeof(trace.chunk[0]));
+  trace.count = 0;
+}
+
+static void trace_exit(void) {
+  (void)pthread_mutex_lock(&trace.lock);
+  trace_flush();
+  (void)pthread_mutex_unlock(&trace.lock);
+}
+
+void vtpc_trace_start(void) {
+  const char* path = getenv("VTPC_TRACE");
+  if (path == NULL || *path == '\0') {
+    return;
+  }
+  int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    return;
+  }
+  // Whoever finds the trace empty writes the header.
+  (void)flock(fd, LOCK_EX);
+  if (lseek(fd, 0, SEEK_END) == 0) {
+    struct vtpc_trace_header header = {
+        .magic = VTPC_TRACE_MAGIC,
+        .block_size = VTPC_BLOCK_SIZE,
+        .record_size = sizeof(struct vtpc_trace_record),
+    };
+    write_all(fd, &header, sizeof(header));
+  }
+  (void)flock(fd, LOCK_UN);
+  trace.fd = fd;
+  (void)atexit(trace_exit);
+}
+
+void vtpc_trace(
+    enum vtpc_trace_op op,
+    int fd,
+    int file,
+    off_t offset,
+    uint64_t length,
+    int arg
+) {
+  if (trace.fd == -1) {
+    return;
+  }
+  struct vtpc_trace_record record = {
+      .time = vtpc_clock_ns(),
+      .offset = offset,
+      .length = length,
+      .op = (uint16_t)op,
+      .fd = (int16_t)fd,
+      .arg = arg,
+  };
+  vtpc_cache_identity(file, &record.dev, &record.ino);
+
+  (void)pthread_mutex_lock(&trace.lock);
+  trace.chunk[trace.count++] = record;
+  if (trace.count == TRACE_CHUNK) {
+    trace_flush();
+  }
+  (void)pthread_mutex_unlock(&trace.lock);
+}
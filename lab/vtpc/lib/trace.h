@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// A trace lists the calls made through vtpc, for replaying them offline.
+// It is a binary file of native byte order: a header, then one fixed-size
+// record per call that succeeded, in the order the calls finished. Several
+// processes may append to the same trace; their records interleave in
+// chunks, and sorting them by time restores the order.
+
+#define VTPC_TRACE_MAGIC 0x7674706374726331ULL  // "vtpctrc1"
+
+struct vtpc_trace_header {
+  uint64_t magic;
+  uint32_t block_size;
+  uint32_t record_size;
+};
+
+enum vtpc_trace_op {
+  VTPC_TRACE_OPEN,      // `arg` is the flags
+  VTPC_TRACE_CLOSE,
+  VTPC_TRACE_READ,      // also pread, readv; `length` bytes were read
+  VTPC_TRACE_WRITE,     // also pwrite, writev; `length` bytes were written
+  VTPC_TRACE_LSEEK,     // `offset` is the new position, `arg` the whence
+  VTPC_TRACE_FSYNC,
+  VTPC_TRACE_ADVICE,    // `length` is the hint
+  VTPC_TRACE_PREFETCH,
+  VTPC_TRACE_FADVISE,   // `arg` is the advice; `length` is SIZE_MAX when
+                        // the range reaches to the end of the file
+  VTPC_TRACE_VIEW,      // a read view of `length` bytes
+};
+
+struct vtpc_trace_record {
+  uint64_t time;  // CLOCK_MONOTONIC when the call finished, in nanoseconds
+  uint64_t dev;   // st_dev and st_ino of the file
+  uint64_t ino;
+  int64_t offset;
+  uint64_t length;
+  uint16_t op;
+  int16_t fd;
+  int32_t arg;
+};
+
+// Starts appending to the trace named by VTPC_TRACE, if any, creating it
+// as needed. What is recorded is written out in chunks and at exit.
+void vtpc_trace_start(void);
+
+// Records a call on descriptor `fd` of cache file `file`, if tracing.
+void vtpc_trace(
+    enum vtpc_trace_op op,
+    int fd,
+    int file,
+    off_t offset,
+    uint64_t length,
+    int arg
+);
@@ -1,30 +1,740 @@
+#define _GNU_SOURCE
 #include "vtpc.h"
 
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include "cache.h"
+#include "stats.h"
+#include "trace.h"
+
+// A handle is used by one call at a time; the lock keeps the position
+// consistent when threads share it. Positional calls and fsyncs only take
+// the lock to start and to finish, and close waits until none is left.
+struct handle {
+  pthread_mutex_t lock;
+  pthread_cond_t idle;  // the last positional call finished
+  bool used;
+  int file;
+  int flags;
+  off_t pos;
+  struct vtpc_stream stream;
+  uint32_t views;
+  uint32_t calls;  // positional calls, fsyncs and prefetches in flight
+  bool closing;    // atomic; fails new calls and cuts a warm-up short
+  struct vtpc_latency read;
+  struct vtpc_latency write;
+  struct vtpc_latency fsync;
+};
+
+// Guards `used` together with the handle lock, so that it can be scanned
+// without taking every handle lock.
+static pthread_mutex_t handles_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct handle handles[VTPC_MAX_FILES];
+static pthread_once_t handles_once = PTHREAD_ONCE_INIT;
+
+// Prefetches wait here for a worker. Each holds a call on its handle, so
+// that close either withdraws it or waits for it to finish. When the queue
+// is full, new ones are turned away.
+#define PREFETCH_QUEUE 64
+#define PREFETCH_WORKERS 2
+
+struct prefetch {
+  struct handle* handle;
+  int file;
+  off_t offset;
+  size_t count;
+  bool cold;
+  bool warm;  // of the blocks in the file's manifest rather than a range
+};
+
+// Taken after handle locks.
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_wake = PTHREAD_COND_INITIALIZER;
+static struct prefetch prefetch_queue[PREFETCH_QUEUE];  // oldest first
+static uint32_t prefetch_count;
+static uint32_t prefetch_workers;
+
+// Latencies of all calls, including those on handles closed since.
+static struct {
+  struct vtpc_latency read;
+  struct vtpc_latency write;
+  struct vtpc_latency fsync;
+} latency;
+
+static void stats_dump(void) {
+  const char* path = getenv("VTPC_STATS");
+  struct vtpc_stats stats;
+  if (path == NULL || vtpc_stats(-1, &stats) == -1) {
+    return;
+  }
+  bool console = strcmp(path, "-") == 0;
+  int fd = console ? STDERR_FILENO
+                   : open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    return;
+  }
+  (void)vtpc_stats_write_json(fd, &stats);
+  if (!console) {
+    (void)close(fd);
+  }
+}
+
+static void handles_init(void) {
+  for (int i = 0; i < VTPC_MAX_FILES; ++i) {
+    (void)pthread_mutex_init(&handles[i].lock, NULL);
+    (void)pthread_cond_init(&handles[i].idle, NULL);
+  }
+  if (getenv("VTPC_STATS") != NULL) {
+    (void)atexit(stats_dump);
+  }
+  vtpc_trace_start();
+}
+
+// Returns the handle locked, unless it is being closed.
+static struct handle* handle_get(int fd) {
+  if (fd < 0 || fd >= VTPC_MAX_FILES) {
+    errno = EBADF;
+    return NULL;
+  }
+  (void)pthread_once(&handles_once, handles_init);
+  struct handle* handle = &handles[fd];
+  (void)pthread_mutex_lock(&handle->lock);
+  if (!handle->used || handle->closing) {
+    (void)pthread_mutex_unlock(&handle->lock);
+    errno = EBADF;
+    return NULL;
+  }
+  return handle;
+}
+
+static void handle_put(struct handle* handle) {
+  (void)pthread_mutex_unlock(&handle->lock);
+}
+
+// Ends a call that ran without the handle lock, which is held again.
+static void call_done(struct handle* handle) {
+  if (--handle->calls == 0) {
+    (void)pthread_cond_broadcast(&handle->idle);
+  }
+}
+
+// Loads the blocks of a manifest in order, runs of neighbours together,
+// until the handle is closed.
+static void prefetch_warm(const struct prefetch* job) {
+  size_t count = 0;
+  uint64_t* blocks = vtpc_cache_manifest(job->file, &count);
+  size_t i = 0;
+  while (i < count &&
+         !__atomic_load_n(&job->handle->closing, __ATOMIC_RELAXED)) {
+    size_t run = 1;
+    while (i + run < count && blocks[i + run] == blocks[i] + run) {
+      ++run;
+    }
+    // A damaged manifest must not overflow the offsets.
+    if (blocks[i] <= ((uint64_t)INT64_MAX / VTPC_BLOCK_SIZE) - run) {
+      (void)vtpc_cache_prefetch(
+          job->file,
+          (off_t)(blocks[i] * VTPC_BLOCK_SIZE),
+          run * VTPC_BLOCK_SIZE,
+          false
+      );
+    }
+    i += run;
+  }
+  free(blocks);
+}
+
+static void* prefetch_main(void* arg) {
+  (void)arg;
+  (void)pthread_mutex_lock(&prefetch_lock);
+  while (true) {
+    while (prefetch_count == 0) {
+      (void)pthread_cond_wait(&prefetch_wake, &prefetch_lock);
+    }
+    struct prefetch job = prefetch_queue[0];
+    --prefetch_count;
+    memmove(
+        &prefetch_queue[0],
+        &prefetch_queue[1],
+        prefetch_count * sizeof(job)
+    );
+    (void)pthread_mutex_unlock(&prefetch_lock);
+
+    if (job.warm) {
+      prefetch_warm(&job);
+    } else {
+      (void)vtpc_cache_prefetch(job.file, job.offset, job.count, job.cold);
+    }
+    (void)pthread_mutex_lock(&job.handle->lock);
+    call_done(job.handle);
+    (void)pthread_mutex_unlock(&job.handle->lock);
+
+    (void)pthread_mutex_lock(&prefetch_lock);
+  }
+  return NULL;
+}
+
+// Queues a prefetch on a locked handle, starting the workers on first use.
+static int prefetch_push(
+    struct handle* handle, off_t offset, size_t count, bool warm
+) {
+  (void)pthread_mutex_lock(&prefetch_lock);
+  while (prefetch_workers < PREFETCH_WORKERS) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, prefetch_main, NULL) != 0) {
+      break;
+    }
+    (void)pthread_detach(thread);
+    ++prefetch_workers;
+  }
+  int result = -1;
+  if (prefetch_workers == 0 || prefetch_count == PREFETCH_QUEUE) {
+    errno = EAGAIN;
+  } else {
+    prefetch_queue[prefetch_count++] = (struct prefetch){
+        .handle = handle,
+        .file = handle->file,
+        .offset = offset,
+        .count = count,
+        .cold = handle->stream.advice == POSIX_FADV_NOREUSE,
+        .warm = warm,
+    };
+    ++handle->calls;
+    (void)pthread_cond_signal(&prefetch_wake);
+    result = 0;
+  }
+  (void)pthread_mutex_unlock(&prefetch_lock);
+  return result;
+}
+
+// Drops the prefetches a locked handle still has queued.
+static void prefetch_withdraw(struct handle* handle) {
+  (void)pthread_mutex_lock(&prefetch_lock);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < prefetch_count; ++i) {
+    if (prefetch_queue[i].handle == handle) {
+      --handle->calls;
+    } else {
+      prefetch_queue[kept++] = prefetch_queue[i];
+    }
+  }
+  prefetch_count = kept;
+  (void)pthread_mutex_unlock(&prefetch_lock);
+}
+
 int vtpc_open(const char* path, int mode, int access) {
-  return open(path, mode, access);
+  (void)pthread_once(&handles_once, handles_init);
+  int file = vtpc_cache_open(path, mode, (mode_t)access);
+  if (file == -1) {
+    return -1;
+  }
+
+  (void)pthread_mutex_lock(&handles_lock);
+  int fd = 0;
+  while (fd < VTPC_MAX_FILES && handles[fd].used) {
+    ++fd;
+  }
+  if (fd == VTPC_MAX_FILES) {
+    (void)pthread_mutex_unlock(&handles_lock);
+    (void)vtpc_cache_close(file);
+    errno = EMFILE;
+    return -1;
+  }
+
+  struct handle* handle = &handles[fd];
+  (void)pthread_mutex_lock(&handle->lock);
+  handle->used = true;
+  handle->file = file;
+  handle->flags = mode;
+  handle->pos = 0;
+  handle->views = 0;
+  handle->calls = 0;
+  handle->closing = false;
+  memset(&handle->read, 0, sizeof(handle->read));
+  memset(&handle->write, 0, sizeof(handle->write));
+  memset(&handle->fsync, 0, sizeof(handle->fsync));
+  handle->stream = (struct vtpc_stream){
+      .next = 0, .window = 0, .advice = POSIX_FADV_NORMAL
+  };
+  if (vtpc_cache_warm_due(file)) {
+    (void)prefetch_push(handle, 0, 0, true);
+  }
+  (void)pthread_mutex_unlock(&handle->lock);
+  (void)pthread_mutex_unlock(&handles_lock);
+  vtpc_trace(VTPC_TRACE_OPEN, fd, file, 0, 0, mode);
+  return fd;
 }
 
+// Waits for the calls in flight without handles_lock, so that opens and
+// closes of other descriptors go on meanwhile. The slot stays used, and
+// new calls on it fail, until they are done.
 int vtpc_close(int fd) {
-  return close(fd);
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  if (handle->views > 0) {
+    handle_put(handle);
+    errno = EBUSY;
+    return -1;
+  }
+  __atomic_store_n(&handle->closing, true, __ATOMIC_RELAXED);
+  prefetch_withdraw(handle);
+  while (handle->calls > 0) {
+    (void)pthread_cond_wait(&handle->idle, &handle->lock);
+  }
+  int file = handle->file;
+  handle_put(handle);
+
+  (void)pthread_mutex_lock(&handles_lock);
+  (void)pthread_mutex_lock(&handle->lock);
+  handle->used = false;
+  (void)pthread_mutex_unlock(&handle->lock);
+  (void)pthread_mutex_unlock(&handles_lock);
+  vtpc_trace(VTPC_TRACE_CLOSE, fd, file, 0, 0, 0);
+  return vtpc_cache_close(file);
+}
+
+static bool handle_may(const struct handle* handle, bool write) {
+  int mode = handle->flags & O_ACCMODE;
+  if (mode == (write ? O_RDONLY : O_WRONLY)) {
+    errno = EBADF;
+    return false;
+  }
+  return true;
+}
+
+// Reads through the cache, or past it with O_DIRECT.
+static ssize_t read_mode(
+    int file,
+    int flags,
+    const struct iovec* iov,
+    size_t count,
+    off_t offset,
+    struct vtpc_stream* stream
+) {
+  if ((flags & O_DIRECT) != 0) {
+    return vtpc_cache_read_direct(file, iov, count, offset);
+  }
+  return vtpc_cache_readv(file, iov, count, offset, stream);
+}
+
+// Writes into the cache, then with O_DIRECT writes the blocks back and
+// drops those no view holds, and with O_SYNC or O_DSYNC syncs the file.
+// Either fails as a whole if that fails, though what was written stays
+// cached.
+static ssize_t write_mode(
+    int file, int flags, const struct iovec* iov, size_t count, off_t offset
+) {
+  ssize_t done = vtpc_cache_writev(file, iov, count, offset);
+  if (done <= 0) {
+    return done;
+  }
+  if ((flags & O_DIRECT) != 0 &&
+      vtpc_cache_drop(file, offset, (size_t)done, true) == -1) {
+    return -1;
+  }
+  if ((flags & O_DSYNC) != 0 && vtpc_cache_sync(file) == -1) {
+    return -1;
+  }
+  return done;
+}
+
+static ssize_t handle_read(
+    struct handle* handle, const struct iovec* iov, size_t count
+) {
+  if (!handle_may(handle, false)) {
+    return -1;
+  }
+
+  ssize_t done = read_mode(
+      handle->file, handle->flags, iov, count, handle->pos, &handle->stream
+  );
+  if (done > 0) {
+    handle->pos += done;
+  }
+  return done;
+}
+
+static ssize_t handle_write(
+    struct handle* handle, const struct iovec* iov, size_t count
+) {
+  if (!handle_may(handle, true)) {
+    return -1;
+  }
+  if ((handle->flags & O_APPEND) != 0) {
+    handle->pos = vtpc_cache_size(handle->file);
+  }
+
+  ssize_t done =
+      write_mode(handle->file, handle->flags, iov, count, handle->pos);
+  if (done > 0) {
+    handle->pos += done;
+  }
+  return done;
+}
+
+static off_t handle_lseek(struct handle* handle, off_t offset, int whence) {
+  off_t base = 0;
+  switch (whence) {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = handle->pos;
+      break;
+    case SEEK_END:
+      base = vtpc_cache_size(handle->file);
+      break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+
+  // As lseek(2): a position past what off_t holds overflows, one before
+  // the start of the file is invalid.
+  off_t pos = 0;
+  if (__builtin_add_overflow(base, offset, &pos)) {
+    errno = (offset > 0) ? EOVERFLOW : EINVAL;
+    return -1;
+  }
+  if (pos < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  handle->pos = pos;
+  return handle->pos;
+}
+
+// Returns the number of bytes in the segments, or -1 if there are too many
+// of them or bytes to return the count of.
+static ssize_t iov_total(const struct iovec* iov, int iovcnt) {
+  if (iovcnt < 0 || iovcnt > IOV_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len > (size_t)SSIZE_MAX - total) {
+      errno = EINVAL;
+      return -1;
+    }
+    total += iov[i].iov_len;
+  }
+  return (ssize_t)total;
+}
+
+static ssize_t transfer(
+    int fd, const struct iovec* iov, size_t count, bool write
+) {
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  uint64_t start = vtpc_clock_ns();
+  ssize_t result = write ? handle_write(handle, iov, count)
+                         : handle_read(handle, iov, count);
+  vtpc_latency_add(write ? &handle->write : &handle->read, start);
+  vtpc_latency_add(write ? &latency.write : &latency.read, start);
+  if (result != -1) {
+    vtpc_trace(
+        write ? VTPC_TRACE_WRITE : VTPC_TRACE_READ,
+        fd,
+        handle->file,
+        handle->pos - result,
+        (uint64_t)result,
+        0
+    );
+  }
+  handle_put(handle);
+  return result;
+}
+
+// Runs without the handle lock, so that threads sharing the handle do not
+// wait for each other. The readahead state is shared with the other calls
+// on the handle, and whichever call finishes last keeps its own.
+static ssize_t transfer_at(
+    int fd, const struct iovec* iov, size_t count, off_t offset, bool write
+) {
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  if (!handle_may(handle, write)) {
+    handle_put(handle);
+    return -1;
+  }
+  if (offset < 0) {
+    handle_put(handle);
+    errno = EINVAL;
+    return -1;
+  }
+  int file = handle->file;
+  int flags = handle->flags;
+  struct vtpc_stream stream = handle->stream;
+  ++handle->calls;
+  handle_put(handle);
+
+  uint64_t start = vtpc_clock_ns();
+  ssize_t result =
+      write ? write_mode(file, flags, iov, count, offset)
+            : read_mode(file, flags, iov, count, offset, &stream);
+  vtpc_latency_add(write ? &handle->write : &handle->read, start);
+  vtpc_latency_add(write ? &latency.write : &latency.read, start);
+  if (result != -1) {
+    vtpc_trace(
+        write ? VTPC_TRACE_WRITE : VTPC_TRACE_READ,
+        fd,
+        file,
+        offset,
+        (uint64_t)result,
+        0
+    );
+  }
+
+  (void)pthread_mutex_lock(&handle->lock);
+  if (!write) {
+    handle->stream.next = stream.next;
+    handle->stream.window = stream.window;
+  }
+  call_done(handle);
+  (void)pthread_mutex_unlock(&handle->lock);
+  return result;
 }
 
 ssize_t vtpc_read(int fd, void* buf, size_t count) {
-  return read(fd, buf, count);
+  struct iovec iov = {buf, count};
+  return transfer(fd, &iov, count, false);
 }
 
 ssize_t vtpc_write(int fd, const void* buf, size_t count) {
-  return write(fd, buf, count);
+  struct iovec iov = {(void*)buf, count};
+  return transfer(fd, &iov, count, true);
+}
+
+ssize_t vtpc_pread(int fd, void* buf, size_t count, off_t offset) {
+  struct iovec iov = {buf, count};
+  return transfer_at(fd, &iov, count, offset, false);
+}
+
+ssize_t vtpc_pwrite(int fd, const void* buf, size_t count, off_t offset) {
+  struct iovec iov = {(void*)buf, count};
+  return transfer_at(fd, &iov, count, offset, true);
+}
+
+ssize_t vtpc_readv(int fd, const struct iovec* iov, int iovcnt) {
+  ssize_t count = iov_total(iov, iovcnt);
+  return (count == -1) ? -1 : transfer(fd, iov, (size_t)count, false);
+}
+
+ssize_t vtpc_writev(int fd, const struct iovec* iov, int iovcnt) {
+  ssize_t count = iov_total(iov, iovcnt);
+  return (count == -1) ? -1 : transfer(fd, iov, (size_t)count, true);
 }
 
 off_t vtpc_lseek(int fd, off_t offset, int whence) {
-  return lseek(fd, offset, whence);
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  off_t result = handle_lseek(handle, offset, whence);
+  if (result != -1) {
+    vtpc_trace(VTPC_TRACE_LSEEK, fd, handle->file, result, 0, whence);
+  }
+  handle_put(handle);
+  return result;
 }
 
+// Runs without the handle lock like transfer_at, so that fsyncs of threads
+// sharing the handle can join the same write-back, and other calls on it
+// need not wait for the disk.
 int vtpc_fsync(int fd) {
-  return fsync(fd);
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  int file = handle->file;
+  ++handle->calls;
+  handle_put(handle);
+
+  uint64_t start = vtpc_clock_ns();
+  int result = vtpc_cache_sync(file);
+  vtpc_latency_add(&handle->fsync, start);
+  vtpc_latency_add(&latency.fsync, start);
+  if (result == 0) {
+    vtpc_trace(VTPC_TRACE_FSYNC, fd, file, 0, 0, 0);
+  }
+
+  (void)pthread_mutex_lock(&handle->lock);
+  call_done(handle);
+  (void)pthread_mutex_unlock(&handle->lock);
+  return result;
+}
+
+int vtpc_advice(int fd, off_t offset, access_hint_t hint) {
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  int result = -1;
+  if (hint >= (UINT64_C(1) << 63U)) {
+    errno = EINVAL;
+  } else {
+    result = vtpc_cache_advice(handle->file, offset, hint);
+  }
+  if (result == 0) {
+    vtpc_trace(VTPC_TRACE_ADVICE, fd, handle->file, offset, hint, 0);
+  }
+  handle_put(handle);
+  return result;
+}
+
+int vtpc_prefetch(int fd, off_t offset, size_t count) {
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  int result = 0;
+  if (offset < 0) {
+    errno = EINVAL;
+    result = -1;
+  } else if (count > 0) {
+    result = prefetch_push(handle, offset, count, false);
+  }
+  if (result == 0) {
+    vtpc_trace(VTPC_TRACE_PREFETCH, fd, handle->file, offset, count, 0);
+  }
+  handle_put(handle);
+  return result;
+}
+
+int vtpc_fadvise(int fd, off_t offset, off_t len, int advice) {
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  // As with posix_fadvise(), a length of 0 reaches to the end of the file.
+  size_t count = (len == 0) ? SIZE_MAX : (size_t)len;
+  int result = 0;
+  if (offset < 0 || len < 0) {
+    errno = EINVAL;
+    result = -1;
+  } else if (advice == POSIX_FADV_NORMAL ||
+             advice == POSIX_FADV_SEQUENTIAL ||
+             advice == POSIX_FADV_RANDOM || advice == POSIX_FADV_NOREUSE) {
+    handle->stream.advice = advice;
+    handle->stream.window = 0;
+  } else if (advice == POSIX_FADV_WILLNEED) {
+    // Only a hint, which a full queue may drop.
+    (void)prefetch_push(handle, offset, count, false);
+  } else if (advice == POSIX_FADV_DONTNEED) {
+    result = vtpc_cache_drop(handle->file, offset, count, false);
+  } else {
+    errno = EINVAL;
+    result = -1;
+  }
+  if (result == 0) {
+    vtpc_trace(VTPC_TRACE_FADVISE, fd, handle->file, offset, count, advice);
+  }
+  handle_put(handle);
+  return result;
+}
+
+int vtpc_read_view(
+    int fd, off_t offset, size_t count, struct vtpc_view* view
+) {
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  if (!handle_may(handle, false)) {
+    handle_put(handle);
+    return -1;
+  }
+  if (offset < 0) {
+    handle_put(handle);
+    errno = EINVAL;
+    return -1;
+  }
+
+  const void* data = NULL;
+  uint32_t frame = 0;
+  ssize_t size = vtpc_cache_pin(
+      handle->file, offset, count, &handle->stream, &data, &frame
+  );
+  if (size > 0) {
+    ++handle->views;
+  }
+  if (size != -1) {
+    vtpc_trace(VTPC_TRACE_VIEW, fd, handle->file, offset, (uint64_t)size, 0);
+  }
+  handle_put(handle);
+  if (size == -1) {
+    return -1;
+  }
+
+  *view = (struct vtpc_view){
+      .data = data,
+      .size = (size_t)size,
+      .fd = fd,
+      .frame = frame,
+  };
+  return 0;
+}
+
+int vtpc_release(struct vtpc_view* view) {
+  if (view->data == NULL) {
+    return 0;
+  }
+  struct handle* handle = handle_get(view->fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  if (handle->views == 0) {
+    handle_put(handle);
+    errno = EINVAL;
+    return -1;
+  }
+  --handle->views;
+  vtpc_cache_unpin(view->frame);
+  handle_put(handle);
+  view->data = NULL;
+  view->size = 0;
+  return 0;
+}
+
+int vtpc_stats(int fd, struct vtpc_stats* stats) {
+  if (fd == -1) {
+    vtpc_cache_stats(-1, stats);
+    vtpc_latency_load(&latency.read, &stats->read);
+    vtpc_latency_load(&latency.write, &stats->write);
+    vtpc_latency_load(&latency.fsync, &stats->fsync);
+    return 0;
+  }
+
+  struct handle* handle = handle_get(fd);
+  if (handle == NULL) {
+    return -1;
+  }
+  vtpc_cache_stats(handle->file, stats);
+  vtpc_latency_load(&handle->read, &stats->read);
+  vtpc_latency_load(&handle->write, &stats->write);
+  vtpc_latency_load(&handle->fsync, &stats->fsync);
+  handle_put(handle);
+  return 0;
+}
+
+int vtpc_set_capacity(uint32_t blocks) {
+  return vtpc_cache_resize(blocks);
 }
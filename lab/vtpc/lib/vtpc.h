@@ -1,6 +1,106 @@
 #pragma once
 
+#include <stdint.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+
+// The cache is created on the first vtpc_open and configured from the
+// environment:
+//   VTPC_CAPACITY  number of 4 KiB blocks in the pool (default 256);
+//   VTPC_CAPACITY_MAX
+//                  number of blocks vtpc_set_capacity() may grow the pool
+//                  to; their memory is only touched once they are used
+//                  (default: VTPC_CAPACITY);
+//   VTPC_POLICY    replacement policy: lru (default), clock, 2q, arc, lru-k,
+//                  opt; each access costs O(1) but with lru-k and opt,
+//                  which keep their blocks in a heap, O(log capacity);
+//   VTPC_SHARDS    number of independently locked parts the pool is split
+//                  into (default: up to 16, at least 32 blocks each);
+//   VTPC_HUGEPAGES 0 (default), 1 to advise transparent huge pages for the
+//                  pool, 2 to map it from reserved huge pages (falls back
+//                  to 1);
+//   VTPC_IO_URING  0 to do disk I/O with preadv/pwritev instead of io_uring
+//                  (default 1; the fallback is automatic without io_uring);
+//   VTPC_DIRTY_BACKGROUND_RATIO
+//                  percentage of the pool that may be dirty before a
+//                  background thread starts writing back (default 0, no
+//                  thread);
+//   VTPC_DIRTY_RATIO
+//                  percentage of the pool that may be dirty before writers
+//                  wait for write-back (default 0, no limit);
+//   VTPC_SCAN_RATIO
+//                  percentage of the pool that blocks read by sequential
+//                  scans may take from other blocks; beyond it, scans reuse
+//                  their own blocks instead of evicting those the policy
+//                  keeps (default 12, 0 to admit scans like other reads);
+//   VTPC_PSI       microseconds of memory stall within 2 s (PSI "some" in
+//                  /proc/pressure/memory) on which the pool gives up
+//                  a quarter of its blocks, keeping at least an eighth of
+//                  its capacity; it takes an eighth back after every 10 s
+//                  without such stalls (default 0, no monitor; up to
+//                  2000000);
+//   VTPC_MANIFEST  suffix of a manifest file kept next to each file opened,
+//                  e.g. ".hot": the last close and exit list the file's
+//                  cached blocks there, most recently used first, and the
+//                  next open of the file into an empty cache loads them
+//                  back in that order in the background (default: none);
+//   VTPC_ZPOOL     blocks' worth of memory for a second tier that keeps
+//                  clean blocks evicted from the pool compressed, so that
+//                  reading them again costs a decompression instead of
+//                  a disk read; blocks that do not compress to half their
+//                  size are dropped as before (default 0, no tier);
+//   VTPC_MRC       1 to estimate the miss-ratio curve of the cache up to
+//                  twice its capacity from a sample of the blocks accessed,
+//                  see mrc_* in struct vtpc_stats (default 0);
+//   VTPC_AUTOSIZE  budget in blocks, at most the capacity, within which the
+//                  pool is resized every 10 s to the knee of the curve
+//                  measured meanwhile: the smallest size that would have
+//                  missed at most 1% of accesses more than the budget
+//                  (default 0, the size stays as set; implies VTPC_MRC);
+//   VTPC_SYNC_WINDOW
+//                  microseconds an fsync of a file waits for others to join
+//                  it before it flushes, so that all of them share one
+//                  write-back and one sync of the disk; fsyncs that come
+//                  while one flushes always share the next (default 0, up
+//                  to 1000000);
+//   VTPC_STATS     file to write the process-wide statistics to as JSON at
+//                  exit, "-" for standard error (default: none);
+//   VTPC_TRACE     file to append a binary record of every call that
+//                  succeeded to, for sim_trace to replay against each
+//                  policy and cache size (default: none, see trace.h);
+//   VTPC_SHM       name of a POSIX shared memory object to keep the cache in,
+//                  shared by every process that names it (default: none,
+//                  the cache is private to the process).
+//
+// In a shared cache, the first process to attach sets the capacities, the
+// shards, the policy, the compressed tier, whether the curve is estimated
+// and the dirty and scan ratios; the others adopt them, and huge pages are
+// not used. The last close of a file in any process writes it back, but its
+// blocks stay cached for the next open, unless the file's size or mtime
+// changed meanwhile. Processes that die are cleaned up after by the
+// others: their dirty blocks are written back, and blocks they held in read
+// views stay pinned. The object is never removed by vtpc (see
+// shm_unlink(3)).
+
+// All functions are thread-safe. Calls on the same descriptor that use or
+// move the file position are serialized.
+
+// Descriptors opened on the same file (same st_dev and st_ino) share its
+// cached blocks, so each sees what the others wrote without an fsync. The
+// file is written back when its last descriptor is closed. A file that
+// may not be written (EACCES or EROFS) can still be opened O_RDONLY, and
+// writes to it through any descriptor then fail with EBADF.
+
+// Each descriptor caches as the flags it was opened with say. By default,
+// writes stay in the cache until written back (write-back). With O_SYNC or
+// O_DSYNC, every write also syncs the file as vtpc_fsync() does before it
+// returns (write-through). With O_DIRECT, reads take the blocks the cache
+// holds from it and read the others from the disk without caching them,
+// and writes write their blocks back and drop them before they return
+// (bypass), waiting for blocks busy with I/O; blocks held by read views
+// are written back but stay cached. A write that fails to sync or write
+// back returns -1, but its bytes stay cached. Other descriptors of the file
+// keep their own mode.
 
 int vtpc_open(const char* path, int mode, int access);
 int vtpc_close(int fd);
@@ -8,3 +108,110 @@ ssize_t vtpc_read(int fd, void* buf, size_t count);
 ssize_t vtpc_write(int fd, const void* buf, size_t count);
 off_t vtpc_lseek(int fd, off_t offset, int whence);
 int vtpc_fsync(int fd);
+
+// As pread(2) and pwrite(2): the file position is neither used nor moved,
+// also with O_APPEND. Unlike other calls, these and vtpc_fsync() do not
+// wait for each other on the same descriptor, and close waits for them.
+// Calls made once close has started fail with EBADF.
+ssize_t vtpc_pread(int fd, void* buf, size_t count, off_t offset);
+ssize_t vtpc_pwrite(int fd, const void* buf, size_t count, off_t offset);
+
+// As readv(2) and writev(2): one call for all segments, each block looked up
+// once and copied straight to or from the segments it spans.
+ssize_t vtpc_readv(int fd, const struct iovec* iov, int iovcnt);
+ssize_t vtpc_writev(int fd, const struct iovec* iov, int iovcnt);
+
+// Expected time of the next access to the block containing `offset`, on
+// any monotonic scale chosen by the application (smaller is sooner, must
+// be below 2^63). Used by the opt policy, ignored by the others.
+typedef uint64_t access_hint_t;
+
+int vtpc_advice(int fd, off_t offset, access_hint_t hint);
+
+// Starts loading the blocks of `fd` from `offset` to `offset + count` in the
+// background and returns at once, so that reads of them later find them
+// cached or on their way. At most half the cache is loaded per call;
+// blocks already cached are left as they are. Fails with EAGAIN when too
+// many prefetches are pending. Close withdraws those not started yet.
+int vtpc_prefetch(int fd, off_t offset, size_t count);
+
+// As posix_fadvise(3) with POSIX_FADV_* from <fcntl.h>, but returning -1
+// with errno set on failure:
+//   NORMAL      readahead grows with sequential reads (the default);
+//   SEQUENTIAL  every read of the handle reads ahead as far as possible,
+//               and its blocks go on probation like those of scans;
+//   RANDOM      the handle never reads ahead;
+//   NOREUSE     blocks read through the handle go on probation;
+//   WILLNEED    as vtpc_prefetch(), dropped silently when the queue is
+//               full;
+//   DONTNEED    evicts the blocks of the range right away, writing dirty
+//               ones back first; blocks in use stay.
+// The first four apply to the handle as a whole, the others to the range,
+// which reaches to the end of the file when `len` is 0.
+int vtpc_fadvise(int fd, off_t offset, off_t len, int advice);
+
+// Borrowed, read-only window into a cached block.
+struct vtpc_view {
+  const void* data;
+  size_t size;
+  int fd;
+  uint32_t frame;
+};
+
+// Points `view` at the cached bytes of `fd` from `offset` on, without
+// copying them and without moving the file position. The view ends at
+// `count` bytes, at the end of the block or at end of file, whichever comes
+// first; `view->size` is 0 at end of file. The block stays in the cache
+// until the view is released, and a handle with views cannot be closed
+// (EBUSY). Writes through vtpc to the same block show through the view.
+// When every block a file maps to is pinned, reads fail with ENOBUFS.
+int vtpc_read_view(int fd, off_t offset, size_t count, struct vtpc_view* view);
+int vtpc_release(struct vtpc_view* view);
+
+#define VTPC_LATENCY_BUCKETS 32
+#define VTPC_MRC_POINTS 32
+
+// Bucket i counts calls that took from 2^i to 2^(i+1) - 1 nanoseconds; the
+// last bucket also counts everything slower.
+struct vtpc_latency {
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t buckets[VTPC_LATENCY_BUCKETS];
+};
+
+struct vtpc_stats {
+  uint64_t hits;    // block lookups served from the cache
+  uint64_t misses;  // block lookups that had to read the disk
+  uint64_t evictions;
+  uint64_t writebacks;        // dirty blocks written to the disk
+  uint64_t readahead;         // blocks read ahead of the reader
+  uint64_t readahead_hits;    // of those, blocks accessed later
+  uint64_t readahead_wasted;  // of those, blocks dropped before any access
+  uint64_t compressed;        // evicted blocks kept in the VTPC_ZPOOL tier
+  uint64_t compressed_hits;   // hits served from that tier
+  // Miss-ratio curve estimated with VTPC_MRC, of the whole cache also for
+  // a file: of `mrc_accesses` block accesses, mrc_hits[i] would have hit in
+  // an LRU cache of (i + 1) * mrc_step blocks. All zero without VTPC_MRC.
+  uint64_t mrc_step;
+  uint64_t mrc_accesses;
+  uint64_t mrc_hits[VTPC_MRC_POINTS];
+  struct vtpc_latency read;
+  struct vtpc_latency write;
+  struct vtpc_latency fsync;
+};
+
+// Statistics of the file behind `fd`, or of the whole process when `fd` is
+// -1. Cache counters cover every descriptor of the file since the first of
+// them was opened, latencies only calls on `fd`. In a shared cache, the
+// process-wide cache counters are those of all processes attached to it.
+int vtpc_stats(int fd, struct vtpc_stats* stats);
+
+// Changes the number of blocks the pool may hold while the cache runs,
+// setting the cache up if needed, between the number of shards and
+// VTPC_CAPACITY_MAX (else EINVAL). Shrinking drops the blocks past the new
+// capacity, clean ones first and dirty ones once written back; blocks that
+// are pinned or busy with I/O go when they are evicted later. Fails with
+// the error of a write-back that failed, leaving its block cached. The
+// capacity set is also the one the VTPC_PSI monitor grows back to; in
+// a shared cache it applies to all processes.
+int vtpc_set_capacity(uint32_t blocks);
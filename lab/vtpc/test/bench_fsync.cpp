@@ -0,0 +1,137 @@
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Threads write 512 bytes to their own block of the same file and fsync,
+// over and over, with a handle each or all sharing one. Compares plain
+// pwrite(2) and fsync(2) with vtpc, whose concurrent fsyncs of a file share
+// one write-back and one sync of the disk, without and with a window for
+// them to gather in.
+
+namespace {
+
+constexpr size_t record_size = 512;
+constexpr size_t syncs_per_thread = 200;
+const char* const path = "/tmp/fsync";
+
+// Each of these writes through `shared`, or through a descriptor of its own
+// when `shared` is -1.
+auto run_libc(size_t thread_index, int shared) -> void {
+  const int fd = (shared == -1) ? open(path, O_WRONLY) : shared;  // NOLINT
+  vt::check(fd, "open");
+  const std::string record(record_size, 'x');
+  for (size_t i = 0; i < syncs_per_thread; ++i) {
+    const off_t offset = static_cast<off_t>(
+        (thread_index * vt::block_size) + ((i * record_size) % vt::block_size)
+    );
+    vt::check(pwrite(fd, record.data(), record.size(), offset), "pwrite");
+    vt::check(fsync(fd), "fsync");
+  }
+  if (shared == -1) {
+    vt::check(close(fd), "close");
+  }
+}
+
+auto run_vtpc(size_t thread_index, int shared) -> void {
+  const int fd = (shared == -1) ? vtpc_open(path, O_WRONLY, 0) : shared;
+  vt::check(fd, "vtpc_open");
+  const std::string record(record_size, 'x');
+  for (size_t i = 0; i < syncs_per_thread; ++i) {
+    const off_t offset = static_cast<off_t>(
+        (thread_index * vt::block_size) + ((i * record_size) % vt::block_size)
+    );
+    vt::check(
+        vtpc_pwrite(fd, record.data(), record.size(), offset), "vtpc_pwrite"
+    );
+    vt::check(vtpc_fsync(fd), "vtpc_fsync");
+  }
+  if (shared == -1) {
+    vt::check(vtpc_close(fd), "vtpc_close");
+  }
+}
+
+// Runs `threads` threads of `mode`: "libc", or the sync window of vtpc in
+// microseconds; with `shared`, on one descriptor.
+auto run(const std::string& mode, size_t threads, bool shared) -> void {
+  const bool libc = (mode == "libc");
+  if (!libc) {
+    setenv("VTPC_SYNC_WINDOW", mode.c_str(), 1);  // NOLINT
+  }
+  int fd = -1;
+  if (shared) {
+    fd = libc ? open(path, O_WRONLY) : vtpc_open(path, O_WRONLY, 0);  // NOLINT
+    vt::check(fd, "open");
+  }
+  std::vector<std::thread> workers;
+  std::exception_ptr error;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([i, libc, fd, &error] {
+      try {
+        libc ? run_libc(i, fd) : run_vtpc(i, fd);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (shared) {
+    vt::check(libc ? close(fd) : vtpc_close(fd), "close");
+  }
+  const double syncs = static_cast<double>(threads * syncs_per_thread);
+  std::cout << (libc ? "libc" : "vtpc, window = " + mode + " us")
+            << ", threads = " << threads
+            << (shared ? " on one descriptor" : "")
+            << ", fsyncs/s = " << static_cast<size_t>(syncs / elapsed.count())
+            << '\n';
+}
+
+}  // namespace
+
+auto main() -> int try {
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(std::string(8 * vt::block_size, 'x'));
+    file->sync();
+  }
+
+  for (const char* mode : {"libc", "0", "200"}) {
+    for (const bool shared : {false, true}) {
+      for (const size_t threads : {1, 2, 4, 8}) {
+        if (!vt::run_in_child([&] { run(mode, threads, shared); })) {
+          return 1;
+        }
+      }
+    }
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include "index.h"
+#include "list.h"
+}
+
+// Random lookups of resident blocks with 1, 2, 4, ... threads while another
+// thread keeps evicting and loading blocks, against the block index and
+// against a std::unordered_map behind a reader-writer lock. Shows what the
+// lookups of one core cost once they stop sharing a lock.
+
+namespace {
+
+constexpr uint32_t capacity = 1U << 16U;
+constexpr size_t steps = 1U << 22U;
+
+auto key_of(uint64_t file, uint64_t block) -> uint64_t {
+  return (file << 40U) | block;
+}
+
+class index_table {
+public:
+  index_table() {
+    const size_t footprint = vtpc_index_footprint(capacity);
+    memory_.reset(static_cast<char*>(std::aligned_alloc(
+        VTPC_INDEX_ALIGN,
+        (footprint + VTPC_INDEX_ALIGN - 1) / VTPC_INDEX_ALIGN *
+            VTPC_INDEX_ALIGN
+    )));
+    if (!memory_) {
+      throw std::bad_alloc();
+    }
+    index_ = reinterpret_cast<vtpc_index*>(memory_.get());  // NOLINT
+    vtpc_index_init(index_, capacity);
+  }
+
+  auto find(uint64_t key) const -> uint32_t {
+    return vtpc_index_find_unlocked(index_, key);
+  }
+
+  auto insert(uint64_t key, uint32_t value) -> void {
+    const std::lock_guard lock(mutex_);
+    vtpc_index_insert(index_, key, value);
+  }
+
+  auto erase(uint64_t key) -> void {
+    const std::lock_guard lock(mutex_);
+    vtpc_index_erase(index_, key);
+  }
+
+private:
+  struct free_deleter {
+    auto operator()(char* memory) const -> void {
+      std::free(memory);  // NOLINT
+    }
+  };
+
+  std::unique_ptr<char, free_deleter> memory_;
+  vtpc_index* index_ = nullptr;
+  std::mutex mutex_;
+};
+
+class map_table {
+public:
+  map_table() {
+    map_.reserve(capacity);
+  }
+
+  auto find(uint64_t key) const -> uint32_t {
+    const std::shared_lock lock(mutex_);
+    const auto it = map_.find(key);
+    return (it == map_.end()) ? VTPC_NIL : it->second;
+  }
+
+  auto insert(uint64_t key, uint32_t value) -> void {
+    const std::unique_lock lock(mutex_);
+    map_.emplace(key, value);
+  }
+
+  auto erase(uint64_t key) -> void {
+    const std::unique_lock lock(mutex_);
+    map_.erase(key);
+  }
+
+private:
+  std::unordered_map<uint64_t, uint32_t> map_;
+  mutable std::shared_mutex mutex_;
+};
+
+// Fills the table with a cache's worth of blocks of a few files, then has
+// `threads` readers look up random ones while the writer replaces one
+// block at a time. Returns lookups per second per reader.
+template <typename Table>
+auto run(size_t threads) -> double {
+  Table table;
+  std::vector<uint64_t> keys(capacity);
+  for (uint32_t i = 0; i < capacity; ++i) {
+    keys[i] = key_of(i % 8, i);
+    table.insert(keys[i], i);
+  }
+
+  std::atomic<bool> done = false;
+  std::atomic<size_t> found = 0;
+  std::jthread writer([&table, &keys, &done] {
+    uint64_t next = capacity;
+    for (uint32_t i = 0; !done.load(std::memory_order_relaxed);
+         i = (i + 1) % capacity) {
+      table.erase(keys[i]);
+      keys[i] = key_of(next % 8, next);
+      table.insert(keys[i], i);
+      ++next;
+    }
+  });
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> readers;
+    for (size_t i = 0; i < threads; ++i) {
+      readers.emplace_back([&table, &found, i] {
+        std::default_random_engine random(i);  // NOLINT
+        std::uniform_int_distribution<uint64_t> block_dist(0, capacity * 2);
+        size_t hits = 0;
+        for (size_t j = 0; j < steps; ++j) {
+          const uint64_t block = block_dist(random);
+          hits += table.find(key_of(block % 8, block)) != VTPC_NIL;
+        }
+        found += hits;
+      });
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  done = true;
+
+  if (found == 0) {
+    std::cerr << "no lookup found anything\n";
+  }
+  return static_cast<double>(steps) / elapsed.count();
+}
+
+}  // namespace
+
+auto main() -> int try {
+  const size_t max_threads =
+      std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 16);  // NOLINT
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    const double index = run<index_table>(threads);
+    const double map = run<map_table>(threads);
+    std::cout << "threads = " << threads << ", index lookups/s per core = "
+              << static_cast<size_t>(index)
+              << ", unordered_map lookups/s per core = "
+              << static_cast<size_t>(map) << '\n';
+  }
+
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
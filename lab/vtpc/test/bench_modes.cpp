@@ -0,0 +1,130 @@
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// A hot file that fits the cache is read, then a scratch file four times
+// the size of the cache is written and read back through a handle of each
+// caching mode, then the hot file is read again: shows how many of its
+// blocks the scratch file pushed out, and how fast each mode streams.
+// Then a log is appended to in records of 512 bytes, write-back and
+// write-through, to show what durability costs per write.
+
+namespace {
+
+constexpr uint32_t capacity = 1024;
+constexpr size_t hot_blocks = 768;
+constexpr size_t scratch_blocks = 4 * capacity;
+constexpr size_t chunk_blocks = 64;
+constexpr size_t record_size = 512;
+constexpr size_t records = 2000;
+const char* const hot_path = "/tmp/modes_hot";
+const char* const scratch_path = "/tmp/modes_scratch";
+const char* const log_path = "/tmp/modes_log";
+
+// Reads the first `blocks` blocks of `fd`, `chunk` of them per call.
+auto read_all(int fd, size_t blocks, size_t chunk) -> void {
+  std::string buffer(chunk * vt::block_size, 0);
+  for (size_t i = 0; i < blocks; i += chunk) {
+    vt::check(
+        vtpc_pread(fd, buffer.data(), buffer.size(), i * vt::block_size),
+        "vtpc_pread"
+    );
+  }
+}
+
+auto run_scratch(const std::string& name, int flags) -> void {
+  const int hot = vtpc_open(hot_path, O_RDONLY, 0);
+  vt::check(hot, "vtpc_open");
+  // Read once in order, the hot blocks would count as a scan.
+  vt::check(vtpc_fadvise(hot, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+  read_all(hot, hot_blocks, 1);
+
+  const auto start = std::chrono::steady_clock::now();
+  const int scratch =
+      vtpc_open(scratch_path, O_RDWR | O_CREAT | O_TRUNC | flags, 0644);
+  vt::check(scratch, "vtpc_open");
+  const std::string chunk(chunk_blocks * vt::block_size, 's');
+  for (size_t i = 0; i < scratch_blocks; i += chunk_blocks) {
+    vt::check(
+        vtpc_pwrite(scratch, chunk.data(), chunk.size(), i * vt::block_size),
+        "vtpc_pwrite"
+    );
+  }
+  read_all(scratch, scratch_blocks, chunk_blocks);
+  vt::check(vtpc_close(scratch), "vtpc_close");
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  struct vtpc_stats before{};
+  vt::check(vtpc_stats(hot, &before), "vtpc_stats");
+  read_all(hot, hot_blocks, 1);
+  struct vtpc_stats after{};
+  vt::check(vtpc_stats(hot, &after), "vtpc_stats");
+  vt::check(vtpc_close(hot), "vtpc_close");
+
+  const double scratch_mib =
+      static_cast<double>(2 * scratch_blocks * vt::block_size) / (1 << 20);
+  std::cout << "scratch " << name << ": MiB/s = "
+            << static_cast<size_t>(scratch_mib / elapsed.count())
+            << ", hot blocks still cached = " << after.hits - before.hits
+            << " of " << hot_blocks << '\n';
+}
+
+auto run_log(const std::string& name, int flags) -> void {
+  const int log =
+      vtpc_open(log_path, O_WRONLY | O_CREAT | O_TRUNC | flags, 0644);
+  vt::check(log, "vtpc_open");
+  const std::string record(record_size, 'l');
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < records; ++i) {
+    vt::check(vtpc_write(log, record.data(), record.size()), "vtpc_write");
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  vt::check(vtpc_close(log), "vtpc_close");
+  std::cout << "log " << name << ": writes/s = "
+            << static_cast<size_t>(static_cast<double>(records) /
+                                   elapsed.count())
+            << '\n';
+}
+
+}  // namespace
+
+auto main() -> int try {
+  {
+    auto file = vt::file::open_libc(hot_path);
+    file->seek(0);
+    file->write(std::string(hot_blocks * vt::block_size, 'h'));
+    file->sync();
+  }
+  const std::string capacity_text = std::to_string(capacity);
+  setenv("VTPC_CAPACITY", capacity_text.c_str(), 1);  // NOLINT
+  // Unsharded, so that the hot file fits however its blocks hash.
+  setenv("VTPC_SHARDS", "1", 1);  // NOLINT
+
+  const bool ok =
+      vt::run_in_child([] { run_scratch("write-back", 0); }) &&
+      vt::run_in_child([] { run_scratch("bypass", O_DIRECT); }) &&
+      vt::run_in_child([] { run_log("write-back", 0); }) &&
+      vt::run_in_child([] { run_log("write-through", O_DSYNC); });
+  return ok ? 0 : 1;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
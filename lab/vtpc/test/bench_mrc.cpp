@@ -0,0 +1,123 @@
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "autosize.h"
+#include "vtpc.h"
+}
+
+// Random block reads, nine in ten of them from a hot set of 1536 blocks,
+// the rest from all of a file of 6144 blocks. The miss-ratio curve is
+// estimated once with the largest cache, then the miss ratio is measured
+// with LRU caches of several sizes running the same reads, unsharded so
+// that they evict like the LRU cache of the estimate. Shows how close
+// the sampled estimate comes, what it costs, and where the autosizer would
+// put the cache within a budget of the largest size.
+
+namespace {
+
+constexpr size_t blocks = 6144;
+constexpr size_t hot_blocks = 1536;
+constexpr size_t reads = 200000;
+constexpr uint32_t largest = 4096;
+const char* const path = "/tmp/mrc";
+
+// Runs the reads with a cache of `capacity` blocks.
+auto run(uint32_t capacity, bool estimate) -> void {
+  const std::string capacity_text = std::to_string(capacity);
+  setenv("VTPC_CAPACITY", capacity_text.c_str(), 1);  // NOLINT
+  setenv("VTPC_POLICY", "lru", 1);                    // NOLINT
+  setenv("VTPC_SHARDS", "1", 1);                      // NOLINT
+  setenv("VTPC_MRC", estimate ? "1" : "0", 1);        // NOLINT
+
+  const int fd = vtpc_open(path, O_RDONLY, 0);
+  vt::check(fd, "vtpc_open");
+  vt::check(vtpc_fadvise(fd, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+
+  std::default_random_engine random(1);  // NOLINT
+  std::uniform_int_distribution<int> hot_dist(0, 9);
+  std::uniform_int_distribution<off_t> hot_block_dist(0, hot_blocks - 1);
+  std::uniform_int_distribution<off_t> block_dist(0, blocks - 1);
+  std::string buffer(vt::block_size, 0);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < reads; ++i) {
+    const off_t block =
+        (hot_dist(random) != 0) ? hot_block_dist(random) : block_dist(random);
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, block * vt::block_size),
+        "vtpc_pread"
+    );
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  struct vtpc_stats stats{};
+  vt::check(vtpc_stats(-1, &stats), "vtpc_stats");
+  const double accesses = static_cast<double>(stats.hits + stats.misses);
+  std::cout << "blocks = " << capacity << ", estimate = "
+            << (estimate ? "on" : "off") << ", measured miss ratio = "
+            << static_cast<double>(stats.misses) / accesses << ", reads/s = "
+            << static_cast<size_t>(static_cast<double>(reads) /
+                                   elapsed.count())
+            << '\n';
+  if (estimate) {
+    for (uint32_t i = 1; i < VTPC_MRC_POINTS; i += 2) {
+      const uint64_t size = (i + 1) * stats.mrc_step;
+      if (size > largest) {
+        break;
+      }
+      const double hits = static_cast<double>(stats.mrc_hits[i]);
+      std::cout << "  estimated miss ratio at " << size << " blocks = "
+                << 1.0 - (hits / static_cast<double>(stats.mrc_accesses))
+                << '\n';
+    }
+    std::cout << "  knee within " << largest
+              << " blocks = " << vtpc_autosize_knee(&stats, largest) << '\n';
+  }
+  vt::check(vtpc_close(fd), "vtpc_close");
+}
+
+}  // namespace
+
+auto main() -> int try {
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(std::string(blocks * vt::block_size, 'x'));
+    file->sync();
+  }
+
+  const std::pair<uint32_t, bool> runs[] = {
+      {largest, false},
+      {largest, true},
+      {512, false},
+      {1024, false},
+      {1536, false},
+      {2048, false},
+      {3072, false},
+  };
+  for (const auto& [capacity, estimate] : runs) {
+    if (!vt::run_in_child([&] { run(capacity, estimate); })) {
+      return 1;
+    }
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
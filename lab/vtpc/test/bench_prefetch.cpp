@@ -0,0 +1,95 @@
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Random block reads in the manner of ioloader, with a little work on each
+// block, while the next `depth` offsets are prefetched. Every run starts
+// with a cold cache, so that each read goes to the disk unless a prefetch
+// got there first.
+
+namespace {
+
+constexpr size_t blocks = 8192;
+constexpr size_t reads = 4096;
+constexpr auto work = std::chrono::microseconds(20);
+const char* const path = "/tmp/prefetch";
+
+auto run(size_t depth) -> void {
+  const int fd = vtpc_open(path, O_RDONLY, 0);
+  vt::check(fd, "vtpc_open");
+  vt::check(vtpc_fadvise(fd, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+
+  std::default_random_engine random(1);  // NOLINT
+  std::uniform_int_distribution<size_t> block_dist(0, blocks - 1);
+  std::vector<off_t> offsets(reads);
+  for (off_t& offset : offsets) {
+    offset = static_cast<off_t>(block_dist(random) * vt::block_size);
+  }
+
+  std::string buffer(vt::block_size, 0);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < reads; ++i) {
+    if (depth > 0 && i + depth < reads) {
+      (void)vtpc_prefetch(fd, offsets[i + depth], vt::block_size);
+    }
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, offsets[i]), "vtpc_pread"
+    );
+    const auto done = std::chrono::steady_clock::now() + work;
+    while (std::chrono::steady_clock::now() < done) {
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  struct vtpc_stats stats{};
+  vt::check(vtpc_stats(fd, &stats), "vtpc_stats");
+  std::cout << "depth = " << depth << ", prefetch hits = "
+            << stats.readahead_hits << ", misses = " << stats.misses
+            << ", reads/s = "
+            << static_cast<size_t>(static_cast<double>(reads) /
+                                   elapsed.count())
+            << '\n';
+  vt::check(vtpc_close(fd), "vtpc_close");
+}
+
+}  // namespace
+
+auto main() -> int try {
+  const std::string capacity = std::to_string(blocks * 2);
+  setenv("VTPC_CAPACITY", capacity.c_str(), 0);  // NOLINT
+
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(std::string(blocks * vt::block_size, 'x'));
+    file->sync();
+  }
+
+  for (const size_t depth : {0, 1, 4, 16}) {
+    if (!vt::run_in_child([&] { run(depth); })) {
+      return 1;
+    }
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
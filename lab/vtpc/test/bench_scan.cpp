@@ -0,0 +1,129 @@
+#include <sys/types.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Random reads from a hot set of half the cache while another handle scans
+// a file eight times larger than the cache, for each policy with scans
+// admitted like other reads (scan ratio 0) and with scans on probation.
+// Shows how much of the hot set survives the scan. Hot blocks are spread
+// out, so that they fall evenly into all shards.
+
+namespace {
+
+constexpr size_t capacity = 1024;
+constexpr size_t hot_blocks = capacity / 2;
+constexpr size_t hot_stride = 4;
+constexpr size_t cold_blocks = capacity * 8;
+constexpr size_t scan_chunk = 16 * vt::block_size;
+constexpr size_t rounds = 2 * cold_blocks * vt::block_size / scan_chunk;
+constexpr size_t hot_reads = 16;
+const char* const hot_path = "/tmp/scan_hot";
+const char* const cold_path = "/tmp/scan_cold";
+
+auto hot_stats(int fd) -> struct vtpc_stats {
+  struct vtpc_stats stats{};
+  vt::check(vtpc_stats(fd, &stats), "vtpc_stats");
+  return stats;
+}
+
+auto run(const char* policy, const char* ratio) -> void {
+  setenv("VTPC_POLICY", policy, 1);      // NOLINT
+  setenv("VTPC_SCAN_RATIO", ratio, 1);  // NOLINT
+
+  const int hot = vtpc_open(hot_path, O_RDONLY, 0);
+  const int cold = vtpc_open(cold_path, O_RDONLY, 0);
+  vt::check(hot, "vtpc_open");
+  vt::check(cold, "vtpc_open");
+
+  std::string buffer(scan_chunk, 0);
+  std::vector<off_t> order(hot_blocks);
+  std::iota(order.begin(), order.end(), 0);
+  std::default_random_engine random(1);  // NOLINT
+  std::shuffle(order.begin(), order.end(), random);
+  for (const off_t block : order) {
+    vt::check(
+        vtpc_lseek(hot, block * hot_stride * vt::block_size, SEEK_SET),
+        "vtpc_lseek"
+    );
+    vt::check(vtpc_read(hot, buffer.data(), vt::block_size), "vtpc_read");
+  }
+
+  const struct vtpc_stats before = hot_stats(hot);
+  std::uniform_int_distribution<off_t> block_dist(0, hot_blocks - 1);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rounds; ++i) {
+    for (size_t j = 0; j < hot_reads; ++j) {
+      vt::check(
+          vtpc_lseek(
+              hot, block_dist(random) * hot_stride * vt::block_size, SEEK_SET
+          ),
+          "vtpc_lseek"
+      );
+      vt::check(vtpc_read(hot, buffer.data(), vt::block_size), "vtpc_read");
+    }
+    if (vtpc_read(cold, buffer.data(), scan_chunk) == 0) {
+      vt::check(vtpc_lseek(cold, 0, SEEK_SET), "vtpc_lseek");
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  const struct vtpc_stats after = hot_stats(hot);
+
+  const uint64_t hits = after.hits - before.hits;
+  const uint64_t misses = after.misses - before.misses;
+  std::cout << "policy = " << policy << ", scan ratio = " << ratio
+            << ", hot hit ratio = "
+            << static_cast<double>(hits) / static_cast<double>(hits + misses)
+            << ", seconds = " << elapsed.count() << '\n';
+
+  vt::check(vtpc_close(cold), "vtpc_close");
+  vt::check(vtpc_close(hot), "vtpc_close");
+}
+
+}  // namespace
+
+auto main() -> int try {
+  const std::string blocks = std::to_string(capacity);
+  setenv("VTPC_CAPACITY", blocks.c_str(), 0);  // NOLINT
+
+  for (const auto& [path, size] :
+       {std::pair{hot_path, hot_blocks * hot_stride},
+        std::pair{cold_path, cold_blocks}}) {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(std::string(size * vt::block_size, 'x'));
+    file->sync();
+  }
+
+  for (const char* policy : {"lru", "clock", "2q", "arc", "lru-k"}) {
+    for (const char* ratio : {"0", "12"}) {
+      if (!vt::run_in_child([&] { run(policy, ratio); })) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
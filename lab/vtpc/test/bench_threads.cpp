@@ -0,0 +1,79 @@
+#include <sys/types.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file.hpp"
+
+// Random reads from a file that fits in the cache, with 1, 2, 4, ... threads
+// each working through its own handle. Shows how well the cache scales once
+// nothing has to go to the disk.
+auto main() -> int try {
+  constexpr size_t blocks = 1024;
+  constexpr size_t block_size = 4096;
+  constexpr size_t size = blocks * block_size;
+  constexpr size_t record = 512;
+  constexpr size_t steps = (1U << 18U);
+  const char* path = "/tmp/c";
+
+  const size_t max_threads =
+      std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 16);  // NOLINT
+
+  // All handles share the cached file; the slack keeps blocks from being
+  // evicted when an extent of them lands on a fuller shard.
+  const std::string capacity = std::to_string(blocks * 2);
+  setenv("VTPC_CAPACITY", capacity.c_str(), 0);  // NOLINT
+
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(std::string(size, 'x'));
+    file->sync();
+  }
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    std::vector<std::unique_ptr<vt::file>> files;
+    for (size_t i = 0; i < threads; ++i) {
+      files.push_back(vt::file::open_vtpc(path));
+      files.back()->seek(0);
+      (void)files.back()->read(size);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    {
+      std::vector<std::jthread> workers;
+      for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&file = *files[i], i] {
+          std::default_random_engine random(i);  // NOLINT
+          std::uniform_int_distribution<off_t> offset_dist(0, size - record);
+          std::string buffer(record, 0);
+          for (size_t j = 0; j < steps; ++j) {
+            file.seek(offset_dist(random));
+            file.read(buffer.data(), record);
+          }
+        });
+      }
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    const double ops = static_cast<double>(threads * steps);
+    std::cout << "threads = " << threads
+              << ", ops/s = " << static_cast<size_t>(ops / elapsed.count())
+              << '\n';
+  }
+
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
@@ -0,0 +1,125 @@
+#include <sys/types.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "exception.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Random block reads from a file four times larger than the cache, holding
+// mostly repeating ints like those ema-replace-int works on, without and
+// with a compressed tier the size of the cache. Shows how much further the
+// same memory goes once evicted blocks are kept compressed. Every block
+// read is checked against what the file holds.
+
+namespace {
+
+constexpr size_t capacity = 1024;
+constexpr size_t blocks = capacity * 4;
+constexpr size_t reads = blocks * 16;
+constexpr uint32_t run_length = 16;
+const char* const path = "/tmp/zpool";
+
+// Throws unless `buffer` holds the block of `data` at `offset`.
+auto verify(const std::string& data, const std::string& buffer, off_t offset)
+    -> void {
+  if (data.compare(static_cast<size_t>(offset), vt::block_size, buffer) != 0) {
+    throw vt::exception() << "block at " << offset << " read back wrong";
+  }
+}
+
+auto run(const char* zpool, const std::string& data) -> void {
+  setenv("VTPC_ZPOOL", zpool, 1);  // NOLINT
+
+  const int fd = vtpc_open(path, O_RDONLY, 0);
+  vt::check(fd, "vtpc_open");
+  vt::check(vtpc_fadvise(fd, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+
+  std::string buffer(vt::block_size, 0);
+  for (size_t i = 0; i < blocks; ++i) {
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, i * vt::block_size),
+        "vtpc_pread"
+    );
+    verify(data, buffer, static_cast<off_t>(i * vt::block_size));
+  }
+
+  struct vtpc_stats before{};
+  vt::check(vtpc_stats(fd, &before), "vtpc_stats");
+  std::default_random_engine random(1);  // NOLINT
+  std::uniform_int_distribution<off_t> block_dist(0, blocks - 1);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < reads; ++i) {
+    const off_t offset = block_dist(random) * vt::block_size;
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, offset), "vtpc_pread"
+    );
+    verify(data, buffer, offset);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  struct vtpc_stats after{};
+  vt::check(vtpc_stats(fd, &after), "vtpc_stats");
+
+  const uint64_t hits = after.hits - before.hits;
+  const uint64_t misses = after.misses - before.misses;
+  std::cout << "zpool = " << zpool << ", hit ratio = "
+            << static_cast<double>(hits) / static_cast<double>(hits + misses)
+            << ", compressed hits = "
+            << after.compressed_hits - before.compressed_hits
+            << ", reads/s = "
+            << static_cast<size_t>(static_cast<double>(reads) /
+                                   elapsed.count())
+            << '\n';
+  vt::check(vtpc_close(fd), "vtpc_close");
+}
+
+}  // namespace
+
+auto main() -> int try {
+  const std::string blocks_text = std::to_string(capacity);
+  setenv("VTPC_CAPACITY", blocks_text.c_str(), 0);  // NOLINT
+
+  std::string data;
+  {
+    std::vector<int32_t> values(blocks * vt::block_size / sizeof(int32_t));
+    std::default_random_engine random(1);  // NOLINT
+    std::uniform_int_distribution<int32_t> value_dist(0, 1000);
+    for (size_t i = 0; i < values.size(); i += run_length) {
+      std::fill_n(values.begin() + i, run_length, value_dist(random));
+    }
+    data.resize(values.size() * sizeof(int32_t));
+    std::memcpy(data.data(), values.data(), data.size());
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(data);
+    file->sync();
+  }
+
+  for (const char* zpool : {"0", blocks_text.c_str()}) {
+    if (!vt::run_in_child([&] { run(zpool, data); })) {
+      return 1;
+    }
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
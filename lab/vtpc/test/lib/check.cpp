@@ -0,0 +1,21 @@
+#include "check.hpp"
+
+#include <sys/types.h>
+
+#include "exception.hpp"
+
+namespace vt {
+
+auto check(ssize_t result, const char* what) -> void {
+  if (result < 0) {
+    throw vt::exception() << what << " failed";
+  }
+}
+
+auto expect(bool condition, const char* what) -> void {
+  if (!condition) {
+    throw vt::exception() << what;
+  }
+}
+
+}  // namespace vt
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+namespace vt {
+
+// Size of the blocks vtpc caches.
+constexpr size_t block_size = 4096;
+
+// Throws unless `result`, returned by the call `what` names, is not
+// negative, as vtpc and libc calls return -1 on failure.
+auto check(ssize_t result, const char* what) -> void;
+
+// Throws `what` unless `condition` holds.
+auto expect(bool condition, const char* what) -> void;
+
+}  // namespace vt
@@ -0,0 +1,32 @@
+#include "child.hpp"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <exception>
+#include <functional>
+#include <iostream>
+
+namespace vt {
+
+auto run_in_child(const std::function<void()>& run) -> bool {
+  std::cout.flush();
+  const pid_t child = fork();
+  if (child == 0) {
+    try {
+      run();
+    } catch (const std::exception& e) {
+      std::cerr << "exception: " << e.what() << '\n';
+      std::cout.flush();
+      _exit(1);
+    }
+    std::cout.flush();
+    _exit(0);
+  }
+  int status = 0;
+  return child != -1 && waitpid(child, &status, 0) != -1 &&
+         WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}  // namespace vt
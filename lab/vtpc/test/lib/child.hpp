@@ -0,0 +1,13 @@
+#pragma once
+
+#include <functional>
+
+namespace vt {
+
+// Runs `run` in a child process and waits for it, so that it gets a vtpc
+// cache of its own: the cache is set up once per process. Returns whether
+// the child succeeded; an exception `run` throws is reported on stderr and
+// fails it.
+auto run_in_child(const std::function<void()>& run) -> bool;
+
+}  // namespace vt
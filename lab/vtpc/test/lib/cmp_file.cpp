@@ -1,13 +1,16 @@
 #include "cmp_file.hpp"
 
 #include <sys/types.h>
+#include <sys/uio.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 #include <memory>
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "exception.hpp"
 #include "file.hpp"
@@ -48,6 +51,25 @@ void Compare(A lhs, B rhs) {
   }
 }
 
+// Throws unless both sides did as many bytes.
+void CompareCounts(size_t lhs, size_t rhs) {
+  if (lhs != rhs) {
+    throw vt::cmp_file_exception() << lhs << " bytes != " << rhs << " bytes";
+  }
+}
+
+// Segments of the same lengths as `segments`, laid out in `buffer`.
+auto SegmentsIn(const std::vector<iovec>& segments, std::string& buffer)
+    -> std::vector<iovec> {
+  std::vector<iovec> result;
+  size_t offset = 0;
+  for (const iovec& segment : segments) {
+    result.push_back({buffer.data() + offset, segment.iov_len});
+    offset += segment.iov_len;
+  }
+  return result;
+}
+
 cmp_file::cmp_file(std::unique_ptr<file> lhs, std::unique_ptr<file> rhs)
     : lhs_(std::move(lhs)), file_(std::move(rhs)) {
 }
@@ -79,4 +101,77 @@ auto cmp_file::sync() -> void {
   Compare([&] { lhs_->sync(); }, [this] { file_->sync(); });
 }
 
+auto cmp_file::pread(char* buffer, size_t count, off_t offset) -> size_t {
+  std::string lhs(count, ' ');
+  std::string rhs(count, ' ');
+  size_t lhs_count = 0;
+  size_t rhs_count = 0;
+  Compare(
+      [&] { lhs_count = lhs_->pread(lhs.data(), count, offset); },
+      [&] { rhs_count = file_->pread(rhs.data(), count, offset); }
+  );
+  CompareCounts(lhs_count, rhs_count);
+  if (lhs.compare(0, lhs_count, rhs, 0, rhs_count) != 0) {
+    throw vt::cmp_file_exception()
+        << "pread at " << offset << ": '" << lhs.substr(0, lhs_count)
+        << "' != '" << rhs.substr(0, rhs_count) << "'";
+  }
+  memcpy(buffer, lhs.data(), lhs_count);
+  return lhs_count;
+}
+
+auto cmp_file::pwrite(const char* buffer, size_t count, off_t offset)
+    -> size_t {
+  size_t lhs_count = 0;
+  size_t rhs_count = 0;
+  Compare(
+      [&] { lhs_count = lhs_->pwrite(buffer, count, offset); },
+      [&] { rhs_count = file_->pwrite(buffer, count, offset); }
+  );
+  CompareCounts(lhs_count, rhs_count);
+  return lhs_count;
+}
+
+auto cmp_file::readv(const std::vector<iovec>& segments) -> size_t {
+  size_t count = 0;
+  for (const iovec& segment : segments) {
+    count += segment.iov_len;
+  }
+  std::string lhs(count, ' ');
+  std::string rhs(count, ' ');
+  size_t lhs_count = 0;
+  size_t rhs_count = 0;
+  Compare(
+      [&] { lhs_count = lhs_->readv(SegmentsIn(segments, lhs)); },
+      [&] { rhs_count = file_->readv(SegmentsIn(segments, rhs)); }
+  );
+  CompareCounts(lhs_count, rhs_count);
+  if (lhs.compare(0, lhs_count, rhs, 0, rhs_count) != 0) {
+    throw vt::cmp_file_exception()
+        << "readv: '" << lhs.substr(0, lhs_count) << "' != '"
+        << rhs.substr(0, rhs_count) << "'";
+  }
+  size_t offset = 0;
+  for (const iovec& segment : segments) {
+    if (offset >= lhs_count) {
+      break;
+    }
+    const size_t part = std::min(segment.iov_len, lhs_count - offset);
+    memcpy(segment.iov_base, lhs.data() + offset, part);
+    offset += part;
+  }
+  return lhs_count;
+}
+
+auto cmp_file::writev(const std::vector<iovec>& segments) -> size_t {
+  size_t lhs_count = 0;
+  size_t rhs_count = 0;
+  Compare(
+      [&] { lhs_count = lhs_->writev(segments); },
+      [&] { rhs_count = file_->writev(segments); }
+  );
+  CompareCounts(lhs_count, rhs_count);
+  return lhs_count;
+}
+
 }  // namespace vt
@@ -8,12 +8,14 @@
 #include <memory>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include "exception.hpp"
 
 extern "C" {
 #include <fcntl.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "vtpc.h"
@@ -38,6 +40,12 @@ struct io {
   std::function<ssize_t(int fd, const void* buf, size_t count)> write;
   std::function<off_t(int fd, off_t offset, int whence)> lseek;
   std::function<int(int fd)> fsync;
+  std::function<ssize_t(int fd, void* buf, size_t count, off_t offset)> pread;
+  std::function<
+      ssize_t(int fd, const void* buf, size_t count, off_t offset)>
+      pwrite;
+  std::function<ssize_t(int fd, const iovec* iov, int iovcnt)> readv;
+  std::function<ssize_t(int fd, const iovec* iov, int iovcnt)> writev;
 };
 
 template <class A, class T>
@@ -67,6 +75,16 @@ void robust_do(A action, int fd, T* buf, size_t count) {
   }
 }
 
+// Throws unless `result` is a byte count, which it returns.
+auto checked(ssize_t result, const char* what, int fd) -> size_t {
+  if (result < 0) {
+    throw vt::file_exception(result)
+        << "failed to " << what << " file with fd " << fd << ": "
+        << strerror(errno);  // NOLINT(concurrency-mt-unsafe)
+  }
+  return static_cast<size_t>(result);
+}
+
 class io_file final : public file {
 public:
   explicit io_file(std::string_view path, io io)
@@ -106,6 +124,25 @@ public:
     }
   }
 
+  auto pread(char* buffer, size_t count, off_t offset) -> size_t override {
+    return checked(io_.pread(fd_, buffer, count, offset), "pread", fd_);
+  }
+
+  auto pwrite(const char* buffer, size_t count, off_t offset)
+      -> size_t override {
+    return checked(io_.pwrite(fd_, buffer, count, offset), "pwrite", fd_);
+  }
+
+  auto readv(const std::vector<iovec>& segments) -> size_t override {
+    const int count = static_cast<int>(segments.size());
+    return checked(io_.readv(fd_, segments.data(), count), "readv", fd_);
+  }
+
+  auto writev(const std::vector<iovec>& segments) -> size_t override {
+    const int count = static_cast<int>(segments.size());
+    return checked(io_.writev(fd_, segments.data(), count), "writev", fd_);
+  }
+
 private:
   int fd_;
   io io_;
@@ -119,6 +156,10 @@ auto file::open_libc(std::string_view path) -> std::unique_ptr<file> {
       .write = ::write,
       .lseek = ::lseek,
       .fsync = ::fsync,
+      .pread = ::pread,
+      .pwrite = ::pwrite,
+      .readv = ::readv,
+      .writev = ::writev,
   };
 
   return std::make_unique<io_file>(path, std::move(io));
@@ -132,6 +173,10 @@ auto file::open_vtpc(std::string_view path) -> std::unique_ptr<file> {
       .write = ::vtpc_write,
       .lseek = ::vtpc_lseek,
       .fsync = ::vtpc_fsync,
+      .pread = ::vtpc_pread,
+      .pwrite = ::vtpc_pwrite,
+      .readv = ::vtpc_readv,
+      .writev = ::vtpc_writev,
   };
 
   return std::make_unique<io_file>(path, std::move(io));
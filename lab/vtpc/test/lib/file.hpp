@@ -1,11 +1,13 @@
 #pragma once
 
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <cstddef>
 #include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "exception.hpp"
 
@@ -29,6 +31,14 @@ public:
   virtual auto seek(off_t offset) -> void = 0;
   virtual auto sync() -> void = 0;
 
+  // One call each, returning what it returned: reads come up short at end
+  // of file. The positional ones leave the position as it is.
+  virtual auto pread(char* buffer, size_t count, off_t offset) -> size_t = 0;
+  virtual auto pwrite(const char* buffer, size_t count, off_t offset)
+      -> size_t = 0;
+  virtual auto readv(const std::vector<iovec>& segments) -> size_t = 0;
+  virtual auto writev(const std::vector<iovec>& segments) -> size_t = 0;
+
   auto write(std::string_view text) -> void {
     write(text.data(), text.size());
   }
@@ -1,11 +1,13 @@
 #include "log_file.hpp"
 
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <cstddef>
 #include <iostream>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "file.hpp"
 
@@ -34,4 +36,25 @@ auto log_file::sync() -> void {
   file_->sync();
 }
 
+auto log_file::pread(char* buffer, size_t count, off_t offset) -> size_t {
+  std::cerr << "[vt] pread count " << count << " offset " << offset << "\n";
+  return file_->pread(buffer, count, offset);
+}
+
+auto log_file::pwrite(const char* buffer, size_t count, off_t offset)
+    -> size_t {
+  std::cerr << "[vt] pwrite count " << count << " offset " << offset << "\n";
+  return file_->pwrite(buffer, count, offset);
+}
+
+auto log_file::readv(const std::vector<iovec>& segments) -> size_t {
+  std::cerr << "[vt] readv segments " << segments.size() << "\n";
+  return file_->readv(segments);
+}
+
+auto log_file::writev(const std::vector<iovec>& segments) -> size_t {
+  std::cerr << "[vt] writev segments " << segments.size() << "\n";
+  return file_->writev(segments);
+}
+
 }  // namespace vt
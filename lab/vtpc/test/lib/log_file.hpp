@@ -1,9 +1,11 @@
 #pragma once
 
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <cstddef>
 #include <memory>
+#include <vector>
 
 #include "file.hpp"
 
@@ -21,6 +23,11 @@ public:
   auto write(const char* buffer, size_t count) -> void override;
   auto seek(off_t offset) -> void override;
   auto sync() -> void override;
+  auto pread(char* buffer, size_t count, off_t offset) -> size_t override;
+  auto pwrite(const char* buffer, size_t count, off_t offset)
+      -> size_t override;
+  auto readv(const std::vector<iovec>& segments) -> size_t override;
+  auto writev(const std::vector<iovec>& segments) -> size_t override;
 
 private:
   std::unique_ptr<file> file_;
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "exception.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "policy.h"
+#include "trace.h"
+}
+
+// Replays a trace recorded with VTPC_TRACE against every policy and a range
+// of cache sizes, and prints the ratio of block accesses that would have
+// hit. Sizes default to powers of two up to the number of distinct blocks
+// accessed; others may follow the trace on the command line.
+//
+// The pool is simulated as a single shard without readahead, prefetches or
+// I/O in flight, so every frame is evictable. Reads, writes and views access
+// every block they span; POSIX_FADV_DONTNEED drops the blocks of its range,
+// and the last close or an open with O_TRUNC all the blocks of the file, as
+// a private cache does. Opt knows the whole trace, so it stands for the
+// best any policy could do rather than for what vtpc_advice() hints give.
+
+namespace {
+
+constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+constexpr unsigned block_bits = 40;
+
+const struct vtpc_policy* const policies[] = {
+    &vtpc_policy_lru,
+    &vtpc_policy_clock,
+    &vtpc_policy_2q,
+    &vtpc_policy_arc,
+    &vtpc_policy_lruk,
+    &vtpc_policy_opt,
+};
+
+// A block access, or the drop of blocks `key` to `last` of one file.
+struct event {
+  uint64_t key;
+  uint64_t last;
+  uint64_t next;  // position of the next access to the same key, or never
+  bool drop;
+};
+
+struct workload {
+  std::vector<event> events;
+  size_t records = 0;
+  size_t accesses = 0;
+  size_t blocks = 0;
+};
+
+struct trace {
+  uint64_t block_size = 0;
+  std::vector<vtpc_trace_record> records;
+};
+
+auto read_trace(const char* path) -> trace {
+  std::ifstream in(path, std::ios::binary);
+  vtpc_trace_header header{};
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {  // NOLINT
+    throw vt::exception() << path << ": cannot read the trace";
+  }
+  if (header.magic != VTPC_TRACE_MAGIC ||
+      header.record_size != sizeof(vtpc_trace_record) ||
+      header.block_size == 0) {
+    throw vt::exception() << path << ": not a trace of this version";
+  }
+
+  trace result{.block_size = header.block_size, .records = {}};
+  vtpc_trace_record record{};
+  while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {  // NOLINT
+    result.records.push_back(record);
+  }
+  // Chunks of several processes interleave.
+  std::ranges::stable_sort(result.records, {}, &vtpc_trace_record::time);
+  return result;
+}
+
+auto build(const trace& recorded) -> workload {
+  const uint64_t block_size = recorded.block_size;
+  workload work;
+  work.records = recorded.records.size();
+  std::map<std::pair<uint64_t, uint64_t>, uint64_t> files;
+  std::vector<uint32_t> opens;
+  const uint64_t max_block = (uint64_t{1} << block_bits) - 1;
+
+  for (const auto& r : recorded.records) {
+    const auto [it, added] = files.try_emplace({r.dev, r.ino}, files.size());
+    const uint64_t file = it->second;
+    if (added) {
+      opens.push_back(0);
+    }
+    const uint64_t base = file << block_bits;
+    const auto drop_all = [&] {
+      work.events.push_back({base, base | max_block, never, true});
+    };
+
+    switch (r.op) {
+      case VTPC_TRACE_OPEN:
+        ++opens[file];
+        if ((r.arg & O_TRUNC) != 0) {
+          drop_all();
+        }
+        break;
+      case VTPC_TRACE_CLOSE:
+        if (opens[file] > 0 && --opens[file] == 0) {
+          drop_all();
+        }
+        break;
+      case VTPC_TRACE_READ:
+      case VTPC_TRACE_WRITE:
+      case VTPC_TRACE_VIEW:
+        if (r.length > 0 && r.offset >= 0) {
+          const uint64_t first = static_cast<uint64_t>(r.offset) / block_size;
+          const uint64_t last =
+              (static_cast<uint64_t>(r.offset) + r.length - 1) / block_size;
+          for (uint64_t block = first; block <= last; ++block) {
+            work.events.push_back({base | block, 0, never, false});
+          }
+        }
+        break;
+      case VTPC_TRACE_FADVISE:
+        if (r.arg == POSIX_FADV_DONTNEED && r.length > 0 && r.offset >= 0) {
+          const auto offset = static_cast<uint64_t>(r.offset);
+          const uint64_t first = offset / block_size;
+          const uint64_t last = (r.length / block_size >= max_block - first)
+                                    ? max_block
+                                    : (offset + r.length - 1) / block_size;
+          work.events.push_back({base | first, base | last, never, true});
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Opt needs to know when each block is accessed next.
+  std::unordered_map<uint64_t, uint64_t> next_access;
+  for (size_t i = work.events.size(); i-- > 0;) {
+    event& e = work.events[i];
+    if (!e.drop) {
+      const auto [it, added] = next_access.try_emplace(e.key, never);
+      e.next = it->second;
+      it->second = i;
+      ++work.accesses;
+    }
+  }
+  work.blocks = next_access.size();
+  return work;
+}
+
+auto always(uint32_t /*frame*/, void* /*arg*/) -> bool {
+  return true;
+}
+
+// Returns the hit ratio of `policy` with a pool of `capacity` blocks.
+auto simulate(
+    const workload& work, const vtpc_policy& policy, uint32_t capacity
+) -> double {
+  std::vector<uint64_t> memory((policy.footprint(capacity) + 7) / 8);
+  void* state = memory.data();
+  policy.init(state, capacity);
+
+  std::unordered_map<uint64_t, uint32_t> resident;
+  std::vector<uint64_t> keys(capacity);
+  std::vector<uint32_t> free_frames;
+  uint32_t used = 0;
+  size_t hits = 0;
+
+  for (const event& e : work.events) {
+    if (e.drop) {
+      std::vector<uint64_t> dropped;
+      for (const auto& [key, frame] : resident) {
+        if (key >= e.key && key <= e.last) {
+          dropped.push_back(key);
+        }
+      }
+      for (uint64_t key : dropped) {
+        const uint32_t frame = resident[key];
+        policy.remove(state, frame);
+        free_frames.push_back(frame);
+        resident.erase(key);
+      }
+      continue;
+    }
+
+    uint32_t frame = VTPC_NIL;
+    if (const auto it = resident.find(e.key); it != resident.end()) {
+      frame = it->second;
+      policy.hit(state, frame);
+      ++hits;
+    } else {
+      if (!free_frames.empty()) {
+        frame = free_frames.back();
+        free_frames.pop_back();
+      } else if (used < capacity) {
+        frame = used++;
+      } else {
+        frame = policy.evict(state, e.key, always, nullptr);
+        resident.erase(keys[frame]);
+      }
+      keys[frame] = e.key;
+      resident.emplace(e.key, frame);
+      policy.insert(state, frame, e.key);
+    }
+    if (policy.advise != nullptr && e.next != never) {
+      policy.advise(state, frame, e.key, e.next);
+    }
+  }
+  return (work.accesses == 0) ? 0.0
+                              : static_cast<double>(hits) /
+                                    static_cast<double>(work.accesses);
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int try {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " TRACE [BLOCKS...]\n";  // NOLINT
+    return 2;
+  }
+  const std::vector<std::string> args(argv + 1, argv + argc);  // NOLINT
+
+  const workload work = build(read_trace(args[0].c_str()));
+  std::vector<uint32_t> sizes;
+  for (size_t i = 1; i < args.size(); ++i) {
+    sizes.push_back(static_cast<uint32_t>(std::stoul(args[i])));
+  }
+  if (sizes.empty()) {
+    for (uint32_t size = 16; size / 2 < work.blocks; size *= 2) {
+      sizes.push_back(size);
+    }
+  }
+
+  std::cout << "records = " << work.records
+            << ", block accesses = " << work.accesses
+            << ", distinct blocks = " << work.blocks << "\n\n";
+  std::cout << std::setw(10) << "blocks";
+  for (const auto* policy : policies) {
+    std::cout << std::setw(8) << policy->name;
+  }
+  std::cout << '\n';
+  for (uint32_t size : sizes) {
+    if (size == 0) {
+      throw vt::exception() << "a cache holds at least one block";
+    }
+    std::cout << std::setw(10) << size;
+    for (const auto* policy : policies) {
+      std::cout << std::setw(8) << std::fixed << std::setprecision(4)
+                << simulate(work, *policy, size);
+    }
+    std::cout << '\n';
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
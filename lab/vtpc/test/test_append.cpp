@@ -0,0 +1,104 @@
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "check.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Small records appended, as test_seq writes them, to a file whose last
+// block is partly on the disk only: the writes must not read the disk.
+// Reading the appended bytes of that block later must not either, while
+// reading the bytes before them must, once, and find them as they were.
+
+namespace {
+
+constexpr size_t records = 4096;
+const char* const path = "/tmp/test_append";
+
+auto misses(int fd) -> uint64_t {
+  struct vtpc_stats stats{};
+  vt::check(vtpc_stats(fd, &stats), "vtpc_stats");
+  return stats.misses;
+}
+
+auto read_at(int fd, off_t offset, size_t count) -> std::string {
+  std::string data(count, 0);
+  vt::check(vtpc_pread(fd, data.data(), count, offset), "vtpc_pread");
+  return data;
+}
+
+}  // namespace
+
+auto main() -> int try {
+  setenv("VTPC_CAPACITY", "64", 1);  // NOLINT
+
+  // Ends a little into its third block.
+  std::string expected((2 * vt::block_size) + 1808, 0);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    expected[i] = static_cast<char>('a' + (i % 26));
+  }
+  (void)unlink(path);
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(expected);
+    file->sync();
+  }
+  const off_t start = static_cast<off_t>(expected.size());
+
+  const int fd = vtpc_open(path, O_WRONLY | O_APPEND, 0);
+  vt::check(fd, "vtpc_open");
+  for (size_t i = 0; i < records; ++i) {
+    const std::string text = std::to_string(i);
+    vt::check(vtpc_write(fd, text.data(), text.size()), "vtpc_write");
+    expected += text;
+  }
+  vt::expect(misses(fd) == 0, "appends read the disk");
+
+  const int reader = vtpc_open(path, O_RDONLY, 0);
+  vt::check(reader, "vtpc_open");
+  vt::check(vtpc_fadvise(reader, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+  vt::expect(
+      read_at(reader, start, 100) == expected.substr(start, 100),
+      "appended bytes read back wrong"
+  );
+  vt::expect(misses(reader) == 0, "reading appended bytes read the disk");
+  const off_t before = (2 * vt::block_size) + 50;
+  vt::expect(
+      read_at(reader, before, 100) == expected.substr(before, 100),
+      "bytes before the appended ones read back wrong"
+  );
+  vt::expect(
+      misses(reader) == 1, "bytes before the appended ones not read once"
+  );
+  vt::expect(
+      read_at(reader, before, 100) == expected.substr(before, 100),
+      "bytes before the appended ones read back wrong again"
+  );
+  vt::expect(misses(reader) == 1, "a filled block was read again");
+
+  vt::check(vtpc_close(reader), "vtpc_close");
+  vt::check(vtpc_close(fd), "vtpc_close");
+
+  auto file = vt::file::open_libc(path);
+  file->seek(0);
+  vt::expect(
+      file->read(expected.size()) == expected, "file written back wrong"
+  );
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
@@ -0,0 +1,159 @@
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "exception.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Threads write records to their own block of the same file and fsync after
+// each, with a window that makes their fsyncs share write-backs, once with
+// a handle each and once sharing one. Every record must be on the disk once
+// the fsync after it returns, whichever thread's sync wrote it. Then, with
+// a long window, fsyncs of two threads on one handle must share it, and
+// a pread on that handle must not wait for them.
+
+namespace {
+
+constexpr size_t record_size = 512;
+constexpr size_t threads = 4;
+constexpr size_t records = 50;
+constexpr auto window = std::chrono::milliseconds(500);
+const char* const path = "/tmp/test_fsync";
+
+// Writes the records of `thread_index` through `shared`, or through a handle
+// of its own when `shared` is -1.
+auto run(size_t thread_index, int shared) -> void {
+  const int fd = (shared == -1) ? vtpc_open(path, O_RDWR, 0) : shared;
+  vt::check(fd, "vtpc_open");
+  const int disk = open(path, O_RDONLY);  // NOLINT
+  vt::check(disk, "open");
+  std::string on_disk(record_size, 0);
+  for (size_t i = 0; i < records; ++i) {
+    const std::string record(
+        record_size, static_cast<char>('A' + (thread_index * records) + i)
+    );
+    const off_t offset = static_cast<off_t>(
+        (thread_index * vt::block_size) + ((i * record_size) % vt::block_size)
+    );
+    vt::check(
+        vtpc_pwrite(fd, record.data(), record.size(), offset), "vtpc_pwrite"
+    );
+    vt::check(vtpc_fsync(fd), "vtpc_fsync");
+    vt::check(pread(disk, on_disk.data(), record_size, offset), "pread");
+    if (on_disk != record) {
+      throw vt::exception() << "record " << i << " of thread "
+                            << thread_index << " not on disk after fsync";
+    }
+  }
+  vt::check(close(disk), "close");
+  if (shared == -1) {
+    vt::check(vtpc_close(fd), "vtpc_close");
+  }
+}
+
+// Runs `count` threads calling `run` with their index, and throws if any of
+// them threw.
+auto run_threads(size_t count, const std::function<void(size_t)>& run)
+    -> void {
+  std::vector<std::thread> workers;
+  std::atomic<bool> failed = false;
+  for (size_t i = 0; i < count; ++i) {
+    workers.emplace_back([i, &run, &failed] {
+      try {
+        run(i);
+      } catch (const std::exception& e) {
+        std::cerr << "exception: " << e.what() << '\n';
+        failed = true;
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  if (failed) {
+    throw vt::exception() << "a thread failed";
+  }
+}
+
+auto run_records(bool shared) -> void {
+  setenv("VTPC_SYNC_WINDOW", "2000", 1);  // NOLINT
+  const int fd = shared ? vtpc_open(path, O_RDWR, 0) : -1;
+  if (shared) {
+    vt::check(fd, "vtpc_open");
+  }
+  run_threads(threads, [fd](size_t i) { run(i, fd); });
+  if (shared) {
+    vt::check(vtpc_close(fd), "vtpc_close");
+  }
+}
+
+auto run_window() -> void {
+  const std::string window_text = std::to_string(
+      std::chrono::duration_cast<std::chrono::microseconds>(window).count()
+  );
+  setenv("VTPC_SYNC_WINDOW", window_text.c_str(), 1);  // NOLINT
+  const int fd = vtpc_open(path, O_RDWR, 0);
+  vt::check(fd, "vtpc_open");
+
+  const auto start = std::chrono::steady_clock::now();
+  run_threads(3, [fd](size_t i) {
+    if (i > 0) {
+      const std::string record(record_size, static_cast<char>('0' + i));
+      vt::check(
+          vtpc_pwrite(fd, record.data(), record.size(), i * vt::block_size),
+          "vtpc_pwrite"
+      );
+      vt::check(vtpc_fsync(fd), "vtpc_fsync");
+      return;
+    }
+    std::this_thread::sleep_for(window / 5);
+    char byte = 0;
+    const auto read_start = std::chrono::steady_clock::now();
+    vt::check(vtpc_pread(fd, &byte, 1, 0), "vtpc_pread");
+    if (std::chrono::steady_clock::now() - read_start > window / 2) {
+      throw vt::exception() << "vtpc_pread waited for an fsync";
+    }
+  });
+  if (std::chrono::steady_clock::now() - start > window * 9 / 5) {
+    throw vt::exception() << "fsyncs on one handle did not share a window";
+  }
+  vt::check(vtpc_close(fd), "vtpc_close");
+}
+
+}  // namespace
+
+auto main() -> int try {
+  setenv("VTPC_CAPACITY", "64", 1);  // NOLINT
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(std::string(threads * vt::block_size, 0));
+    file->sync();
+  }
+
+  const bool passed = vt::run_in_child([] { run_records(false); }) &&
+                      vt::run_in_child([] { run_records(true); }) &&
+                      vt::run_in_child(run_window);
+  return passed ? 0 : 1;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
@@ -0,0 +1,153 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "exception.hpp"
+
+extern "C" {
+#include "index.h"
+#include "list.h"
+}
+
+// Runs random inserts, erases and lookups against the block index and
+// a std::unordered_map, then has readers look keys up without a lock while
+// a writer keeps erasing and inserting others: keys left alone must always
+// be found, and no key may ever be found with a value it never had.
+
+namespace {
+
+constexpr uint32_t capacity = 1024;
+constexpr size_t steps = 1U << 18U;
+constexpr uint64_t stable_keys = 256;
+constexpr uint64_t churn_keys = 512;
+constexpr size_t readers = 2;
+
+auto value_of(uint64_t key) -> uint32_t {
+  return static_cast<uint32_t>((key * 7) % capacity);
+}
+
+struct free_deleter {
+  auto operator()(void* memory) const -> void {
+    std::free(memory);  // NOLINT
+  }
+};
+
+auto make_index() -> std::unique_ptr<vtpc_index, free_deleter> {
+  const size_t footprint = vtpc_index_footprint(capacity);
+  void* memory = std::aligned_alloc(
+      VTPC_INDEX_ALIGN,
+      (footprint + VTPC_INDEX_ALIGN - 1) / VTPC_INDEX_ALIGN * VTPC_INDEX_ALIGN
+  );
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  auto* index = static_cast<vtpc_index*>(memory);
+  vtpc_index_init(index, capacity);
+  return std::unique_ptr<vtpc_index, free_deleter>(index);
+}
+
+auto test_against_map() -> void {
+  auto index = make_index();
+  std::unordered_map<uint64_t, uint32_t> map;
+  std::default_random_engine random(1);  // NOLINT
+  std::uniform_int_distribution<uint64_t> key_dist(0, 4 * capacity);
+  std::uniform_int_distribution<int> action_dist(0, 2);
+  for (size_t i = 0; i < steps; ++i) {
+    const uint64_t key = key_dist(random) << 20U;
+    const bool present = map.contains(key);
+    const int action = action_dist(random);
+    if (action == 0 && !present && map.size() < capacity) {
+      vtpc_index_insert(index.get(), key, value_of(key));
+      map[key] = value_of(key);
+    } else if (action == 1 && present) {
+      vtpc_index_erase(index.get(), key);
+      map.erase(key);
+    }
+    const uint32_t have = map.contains(key) ? value_of(key) : VTPC_NIL;
+    if (vtpc_index_find(index.get(), key) != have ||
+        vtpc_index_find_unlocked(index.get(), key) != have) {
+      throw vt::exception() << "lookup of " << key << " at step " << i;
+    }
+  }
+  vtpc_index_clear(index.get());
+  for (const auto& [key, value] : map) {
+    if (vtpc_index_find(index.get(), key) != VTPC_NIL) {
+      throw vt::exception() << "key " << key << " left after clear";
+    }
+  }
+}
+
+auto test_concurrent() -> void {
+  auto index = make_index();
+  for (uint64_t key = 0; key < stable_keys; ++key) {
+    vtpc_index_insert(index.get(), key, value_of(key));
+  }
+
+  std::atomic<bool> done = false;
+  std::atomic<bool> failed = false;
+  std::atomic<size_t> lookups = 0;
+  std::vector<std::thread> threads;
+  for (size_t r = 0; r < readers; ++r) {
+    threads.emplace_back([&, r] {
+      std::default_random_engine random(r);  // NOLINT
+      std::uniform_int_distribution<uint64_t> key_dist(
+          0, stable_keys + churn_keys - 1
+      );
+      while (!done.load(std::memory_order_relaxed)) {
+        const uint64_t key = key_dist(random);
+        const uint32_t value = vtpc_index_find_unlocked(index.get(), key);
+        const bool stable = key < stable_keys;
+        if ((stable && value != value_of(key)) ||
+            (!stable && value != VTPC_NIL && value != value_of(key))) {
+          failed = true;
+        }
+        lookups.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+
+  std::default_random_engine random(1);  // NOLINT
+  std::uniform_int_distribution<uint64_t> key_dist(
+      stable_keys, stable_keys + churn_keys - 1
+  );
+  std::vector<bool> present(stable_keys + churn_keys);
+  // Until the readers got their share of the time, too.
+  for (size_t i = 0;
+       i < steps || lookups.load(std::memory_order_relaxed) < steps;
+       ++i) {
+    const uint64_t key = key_dist(random);
+    if (present[key]) {
+      vtpc_index_erase(index.get(), key);
+    } else {
+      vtpc_index_insert(index.get(), key, value_of(key));
+    }
+    present[key] = !present[key];
+  }
+  done = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (failed) {
+    throw vt::exception() << "lock-free lookup found a wrong value";
+  }
+}
+
+}  // namespace
+
+auto main() -> int try {
+  test_against_map();
+  test_concurrent();
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
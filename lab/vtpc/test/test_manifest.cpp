@@ -0,0 +1,105 @@
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "exception.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// One process reads a few blocks of a file and closes it, which lists them
+// in the file's manifest; the next process to open the file finds them
+// loaded in the background, and reads them without a miss and as they are
+// on the disk.
+
+namespace {
+
+constexpr size_t blocks = 64;
+constexpr off_t hot[] = {5, 6, 7, 40, 41};
+const char* const path = "/tmp/test_manifest";
+const char* const suffix = ".hot";
+
+auto read_hot(int fd) -> void {
+  std::string buffer(vt::block_size, 0);
+  for (const off_t block : hot) {
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, block * vt::block_size),
+        "vtpc_pread"
+    );
+    if (buffer != std::string(vt::block_size, static_cast<char>('a' + block))) {
+      throw vt::exception() << "block " << block << " read back wrong";
+    }
+  }
+}
+
+auto open_random() -> int {
+  const int fd = vtpc_open(path, O_RDONLY, 0);
+  vt::check(fd, "vtpc_open");
+  vt::check(vtpc_fadvise(fd, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+  return fd;
+}
+
+auto record() -> void {
+  const int fd = open_random();
+  read_hot(fd);
+  vt::check(vtpc_close(fd), "vtpc_close");
+  if (access((std::string(path) + suffix).c_str(), F_OK) != 0) {
+    throw vt::exception() << "no manifest written";
+  }
+}
+
+auto warm_up() -> void {
+  const int fd = open_random();
+  struct vtpc_stats stats{};
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  do {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    vt::check(vtpc_stats(fd, &stats), "vtpc_stats");
+  } while (stats.readahead < std::size(hot) &&
+           std::chrono::steady_clock::now() < deadline);
+
+  read_hot(fd);
+  vt::check(vtpc_stats(fd, &stats), "vtpc_stats");
+  if (stats.misses != 0 || stats.readahead_hits != std::size(hot)) {
+    throw vt::exception() << "warm-up missed: " << stats.misses
+                          << " misses, " << stats.readahead_hits
+                          << " blocks loaded ahead";
+  }
+  vt::check(vtpc_close(fd), "vtpc_close");
+}
+
+}  // namespace
+
+auto main() -> int try {
+  setenv("VTPC_CAPACITY", "256", 1);   // NOLINT
+  setenv("VTPC_MANIFEST", suffix, 1);  // NOLINT
+  (void)unlink((std::string(path) + suffix).c_str());
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    for (size_t i = 0; i < blocks; ++i) {
+      file->write(std::string(vt::block_size, static_cast<char>('a' + i)));
+    }
+    file->sync();
+  }
+
+  return (vt::run_in_child(record) && vt::run_in_child(warm_up)) ? 0 : 1;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
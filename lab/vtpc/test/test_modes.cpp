@@ -0,0 +1,170 @@
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "check.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Three handles on the same file, one for each mode: write-back, write-through
+// (O_DSYNC) and bypass (O_DIRECT). Checks that each sees what the others
+// wrote, and that what write-through and bypass writes wrote is on the disk
+// when they return, read back through libc.
+
+namespace {
+
+const char* const path = "/tmp/test_modes";
+
+// Reads `count` bytes at `offset` from the disk, bypassing vtpc.
+auto on_disk(off_t offset, size_t count) -> std::string {
+  const int fd = open(path, O_RDONLY);  // NOLINT
+  vt::check(fd, "open");
+  std::string data(count, 0);
+  const ssize_t size = pread(fd, data.data(), count, offset);
+  vt::check(size, "pread");
+  data.resize(static_cast<size_t>(size));
+  vt::check(close(fd), "close");
+  return data;
+}
+
+auto disk_size() -> off_t {
+  const int fd = open(path, O_RDONLY);  // NOLINT
+  vt::check(fd, "open");
+  const off_t size = lseek(fd, 0, SEEK_END);
+  vt::check(size, "lseek");
+  vt::check(close(fd), "close");
+  return size;
+}
+
+}  // namespace
+
+auto main() -> int try {
+  setenv("VTPC_CAPACITY", "64", 1);  // NOLINT
+  unlink(path);
+
+  const int back = vtpc_open(path, O_RDWR | O_CREAT, 0644);  // NOLINT
+  vt::check(back, "vtpc_open");
+  const int through = vtpc_open(path, O_RDWR | O_DSYNC, 0);  // NOLINT
+  vt::check(through, "vtpc_open");
+  const int direct = vtpc_open(path, O_RDWR | O_DIRECT, 0);  // NOLINT
+  vt::check(direct, "vtpc_open");
+
+  // The bypass handle reads the dirty blocks the cache holds.
+  const std::string a(10000, 'a');
+  vt::check(vtpc_pwrite(back, a.data(), a.size(), 0), "vtpc_pwrite");
+  std::string buffer(4 * vt::block_size, 0);
+  vt::expect(
+      vtpc_pread(direct, buffer.data(), buffer.size(), 0) ==
+          static_cast<ssize_t>(a.size()),
+      "direct read stopped short of dirty data"
+  );
+  vt::expect(
+      buffer.compare(0, a.size(), a) == 0, "direct read missed dirty data"
+  );
+
+  // A write-through write is on the disk with the size it gives the file.
+  const std::string b(100, 'b');
+  vt::check(vtpc_pwrite(through, b.data(), b.size(), 10000), "vtpc_pwrite");
+  vt::expect(on_disk(10000, b.size()) == b, "O_DSYNC write not on disk");
+  vt::expect(disk_size() == 10100, "O_DSYNC write left the size behind");
+
+  // A bypass write is on the disk and drops the blocks it wrote.
+  struct vtpc_stats before{};
+  vt::check(vtpc_stats(-1, &before), "vtpc_stats");
+  const std::string c(3 * vt::block_size, 'c');
+  vt::check(
+      vtpc_pwrite(direct, c.data(), c.size(), 4 * vt::block_size), "vtpc_pwrite"
+  );
+  vt::expect(
+      on_disk(4 * vt::block_size, c.size()) == c, "O_DIRECT write not on disk"
+  );
+  vt::check(
+      vtpc_pread(back, buffer.data(), c.size(), 4 * vt::block_size),
+      "vtpc_pread"
+  );
+  vt::expect(
+      buffer.compare(0, c.size(), c) == 0, "O_DIRECT write read back wrong"
+  );
+  struct vtpc_stats after{};
+  vt::check(vtpc_stats(-1, &after), "vtpc_stats");
+  vt::expect(
+      after.evictions - before.evictions == 3,
+      "O_DIRECT write did not drop its blocks"
+  );
+  vt::expect(after.misses > before.misses, "O_DIRECT write left blocks cached");
+
+  // Bypass reads over a hole and from offsets inside blocks.
+  vt::check(vtpc_pwrite(direct, "xyz", 3, 40000), "vtpc_pwrite");
+  vt::expect(
+      vtpc_pread(direct, buffer.data(), 10, 39998) == 5,
+      "direct read past end of file"
+  );
+  vt::expect(
+      buffer.compare(0, 5, std::string("\0\0xyz", 5)) == 0,
+      "direct read over a hole read back wrong"
+  );
+  const off_t inside = (4 * vt::block_size) + 7;
+  vt::expect(
+      vtpc_pread(direct, buffer.data(), vt::block_size, inside) ==
+          vt::block_size,
+      "direct read from inside a block stopped short"
+  );
+  vt::expect(
+      buffer.compare(0, vt::block_size, c, 0, vt::block_size) == 0,
+      "direct read from inside a block read back wrong"
+  );
+
+  // A bypass write into a block held by a view succeeds as a whole: its
+  // bytes reach the disk and show through the view, and that block alone
+  // stays cached.
+  struct vtpc_view view{};
+  vt::check(
+      vtpc_read_view(back, 2 * vt::block_size, 10, &view), "vtpc_read_view"
+  );
+  vt::check(
+      vtpc_lseek(direct, (2 * vt::block_size) - 2, SEEK_SET), "vtpc_lseek"
+  );
+  vt::expect(
+      vtpc_write(direct, "xxpin", 5) == 5,
+      "O_DIRECT write into a pinned block did not write all of it"
+  );
+  vt::expect(
+      vtpc_lseek(direct, 0, SEEK_CUR) == (2 * vt::block_size) + 3,
+      "O_DIRECT write into a pinned block did not move the position"
+  );
+  vt::expect(
+      on_disk((2 * vt::block_size) - 2, 5) == "xxpin",
+      "pinned write not on disk"
+  );
+  vt::expect(
+      std::string(static_cast<const char*>(view.data), 3) == "pin",
+      "pinned write not seen through the view"
+  );
+  vt::check(vtpc_release(&view), "vtpc_release");
+  vt::check(vtpc_stats(-1, &before), "vtpc_stats");
+  vt::check(
+      vtpc_pread(back, buffer.data(), 3, 2 * vt::block_size), "vtpc_pread"
+  );
+  vt::check(vtpc_stats(-1, &after), "vtpc_stats");
+  vt::expect(
+      after.hits - before.hits == 1 && after.misses == before.misses,
+      "pinned block not kept cached"
+  );
+
+  vt::check(vtpc_close(direct), "vtpc_close");
+  vt::check(vtpc_close(through), "vtpc_close");
+  vt::check(vtpc_close(back), "vtpc_close");
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
@@ -0,0 +1,95 @@
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "check.hpp"
+#include "child.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// A file of mode 0444 opened without the rights to write it, as a user
+// other than root: read-only handles read it through the cache, others
+// fail to open it as open(2) does, and writes fail with EBADF.
+
+namespace {
+
+const char* const path = "/tmp/test_readonly";
+constexpr uid_t nobody = 65534;
+
+auto run(const std::string& data) -> void {
+  // Root may write any file, so the check drops to an unprivileged user.
+  if (geteuid() == 0) {
+    vt::check(setgid(nobody), "setgid");
+    vt::check(setuid(nobody), "setuid");
+  }
+
+  errno = 0;
+  vt::expect(
+      vtpc_open(path, O_RDWR, 0) == -1 && errno == EACCES,
+      "O_RDWR open of a read-only file did not fail with EACCES"
+  );
+  errno = 0;
+  vt::expect(
+      vtpc_open(path, O_WRONLY, 0) == -1 && errno == EACCES,
+      "O_WRONLY open of a read-only file did not fail with EACCES"
+  );
+
+  const int fd = vtpc_open(path, O_RDONLY, 0);
+  vt::check(fd, "vtpc_open");
+  const int other = vtpc_open(path, O_RDONLY, 0);
+  vt::check(other, "vtpc_open");
+  std::string buffer(data.size() + 1, 0);
+  vt::expect(
+      vtpc_read(fd, buffer.data(), buffer.size()) ==
+          static_cast<ssize_t>(data.size()),
+      "read of a read-only file stopped short"
+  );
+  buffer.resize(data.size());
+  vt::expect(buffer == data, "read-only file read back wrong");
+  vt::expect(
+      vtpc_pread(other, buffer.data(), 5, 4090) == 5 &&
+          buffer.compare(0, 5, data, 4090, 5) == 0,
+      "read of a read-only file across blocks read back wrong"
+  );
+
+  errno = 0;
+  vt::expect(
+      vtpc_pwrite(fd, "x", 1, 0) == -1 && errno == EBADF,
+      "write to a read-only file did not fail with EBADF"
+  );
+  vt::check(vtpc_close(other), "vtpc_close");
+  vt::check(vtpc_close(fd), "vtpc_close");
+}
+
+}  // namespace
+
+auto main() -> int try {
+  std::string data;
+  for (size_t i = 0; data.size() < 10000; ++i) {
+    data += std::to_string(i) + ' ';
+  }
+  (void)unlink(path);
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(data);
+    file->sync();
+  }
+  vt::check(chmod(path, 0444), "chmod");  // NOLINT
+
+  return vt::run_in_child([&] { run(data); }) ? 0 : 1;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
@@ -0,0 +1,134 @@
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "check.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Shrinks the cache while it holds dirty blocks and a block pinned by
+// a view, then grows it back: the dirty data and the view must survive the
+// shrink, the shrunk cache must hold fewer blocks, and once grown back it
+// must hold as many as before.
+
+namespace {
+
+constexpr uint32_t capacity = 64;
+constexpr uint32_t shrunk = 4;
+constexpr size_t blocks = 2 * capacity;
+constexpr size_t dirty = 48;
+constexpr size_t pinned = 50;
+const char* const path = "/tmp/test_resize";
+
+auto block_data(size_t block, char base) -> std::string {
+  return std::string(vt::block_size, static_cast<char>(base + (block % 26)));
+}
+
+auto misses(int fd) -> uint64_t {
+  struct vtpc_stats stats{};
+  vt::check(vtpc_stats(fd, &stats), "vtpc_stats");
+  return stats.misses;
+}
+
+// Reads blocks `first` to `last` and returns how many of them missed.
+auto read_blocks(int fd, size_t first, size_t last) -> uint64_t {
+  const uint64_t before = misses(fd);
+  std::string buffer(vt::block_size, 0);
+  for (size_t i = first; i < last; ++i) {
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, i * vt::block_size),
+        "vtpc_pread"
+    );
+  }
+  return misses(fd) - before;
+}
+
+}  // namespace
+
+auto main() -> int try {
+  const std::string capacity_text = std::to_string(capacity);
+  setenv("VTPC_CAPACITY", capacity_text.c_str(), 1);  // NOLINT
+  setenv("VTPC_SHARDS", "1", 1);                       // NOLINT
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    for (size_t i = 0; i < blocks; ++i) {
+      file->write(block_data(i, 'a'));
+    }
+    file->sync();
+  }
+
+  const int fd = vtpc_open(path, O_RDWR, 0);
+  vt::check(fd, "vtpc_open");
+  vt::check(vtpc_fadvise(fd, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+  for (size_t i = 0; i < dirty; ++i) {
+    const std::string data = block_data(i, 'A');
+    vt::check(
+        vtpc_pwrite(fd, data.data(), vt::block_size, i * vt::block_size),
+        "vtpc_pwrite"
+    );
+  }
+  struct vtpc_view view{};
+  vt::check(
+      vtpc_read_view(fd, pinned * vt::block_size, vt::block_size, &view),
+      "vtpc_read_view"
+  );
+
+  vt::check(vtpc_set_capacity(shrunk), "vtpc_set_capacity");
+  vt::expect(
+      std::string(static_cast<const char*>(view.data), view.size) ==
+          block_data(pinned, 'a'),
+      "view changed when the cache shrank"
+  );
+  std::string buffer(vt::block_size, 0);
+  for (size_t i = 0; i < dirty; ++i) {
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, i * vt::block_size),
+        "vtpc_pread"
+    );
+    vt::expect(buffer == block_data(i, 'A'), "dirty block lost in the shrink");
+  }
+  (void)read_blocks(fd, capacity, capacity + (2 * shrunk));
+  vt::expect(
+      read_blocks(fd, capacity, capacity + (2 * shrunk)) > 0,
+      "shrunk cache still held as many blocks"
+  );
+  vt::check(vtpc_release(&view), "vtpc_release");
+
+  vt::check(vtpc_set_capacity(capacity), "vtpc_set_capacity");
+  vt::check(vtpc_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED), "vtpc_fadvise");
+  vt::expect(
+      read_blocks(fd, capacity, blocks) == capacity,
+      "blocks left after dropping them all"
+  );
+  vt::expect(
+      read_blocks(fd, capacity, blocks) == 0,
+      "cache grown back does not hold its capacity"
+  );
+  vt::check(vtpc_close(fd), "vtpc_close");
+
+  auto file = vt::file::open_libc(path);
+  file->seek(0);
+  for (size_t i = 0; i < blocks; ++i) {
+    const char base = (i < dirty) ? 'A' : 'a';
+    vt::expect(
+        file->read(vt::block_size) == block_data(i, base),
+        "file written back wrong"
+    );
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
@@ -0,0 +1,196 @@
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "check.hpp"
+#include "exception.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Processes sharing a cache through VTPC_SHM: a reader sees what a writer
+// left dirty in it and writes some of its own, which the writer sees in
+// turn. Then the writer is killed with the blocks still dirty, and the next
+// process to attach writes them back, as the last close would have.
+
+namespace {
+
+const char* const path = "/tmp/test_shm";
+const char* const other_path = "/tmp/test_shm.other";
+const std::string writer_data((2 * vt::block_size) + 100, 'w');
+const off_t writer_offset = 0;
+const std::string reader_data(vt::block_size, 'r');
+const off_t reader_offset = 4 * vt::block_size;
+
+// A child process and the pipes to talk to it: each side sends a byte once
+// it is done with a step and waits for one before the next.
+struct child {
+  pid_t pid;
+  int to;
+  int from;
+};
+
+auto say(int fd) -> void {
+  const char done = 1;
+  vt::check(write(fd, &done, 1), "write");
+}
+
+auto hear(int fd) -> void {
+  char done = 0;
+  if (read(fd, &done, 1) != 1) {
+    throw vt::exception() << "the other process went away";
+  }
+}
+
+// Runs `run` in a child with the ends of the pipes from and to the parent.
+auto start(const std::function<void(int from, int to)>& run) -> child {
+  int down[2];
+  int up[2];
+  vt::check(pipe(down), "pipe");  // NOLINT
+  vt::check(pipe(up), "pipe");    // NOLINT
+  std::cout.flush();
+  const pid_t pid = fork();
+  vt::check(pid, "fork");
+  if (pid == 0) {
+    (void)close(down[1]);
+    (void)close(up[0]);
+    try {
+      run(down[0], up[1]);
+    } catch (const std::exception& e) {
+      std::cerr << "exception: " << e.what() << '\n';
+      _exit(1);
+    }
+    _exit(0);
+  }
+  (void)close(down[0]);
+  (void)close(up[1]);
+  return {pid, down[1], up[0]};
+}
+
+auto succeeded(pid_t pid) -> bool {
+  int status = 0;
+  return waitpid(pid, &status, 0) != -1 && WIFEXITED(status) &&
+         WEXITSTATUS(status) == 0;
+}
+
+// Reads `count` bytes at `offset` from the disk, bypassing vtpc.
+auto on_disk(off_t offset, size_t count) -> std::string {
+  const int fd = open(path, O_RDONLY);  // NOLINT
+  vt::check(fd, "open");
+  std::string data(count, 0);
+  vt::check(pread(fd, data.data(), count, offset), "pread");
+  vt::check(close(fd), "close");
+  return data;
+}
+
+auto read_at(int fd, off_t offset, size_t count) -> std::string {
+  std::string data(count, 0);
+  vt::check(vtpc_pread(fd, data.data(), count, offset), "vtpc_pread");
+  return data;
+}
+
+auto run_writer(int from, int to) -> void {
+  const int fd = vtpc_open(path, O_RDWR, 0);
+  vt::check(fd, "vtpc_open");
+  vt::check(
+      vtpc_pwrite(fd, writer_data.data(), writer_data.size(), writer_offset),
+      "vtpc_pwrite"
+  );
+  say(to);
+  hear(from);
+  vt::expect(
+      read_at(fd, reader_offset, reader_data.size()) == reader_data,
+      "writer did not see what the reader wrote"
+  );
+  say(to);
+  // Killed here, with the file open and its blocks dirty.
+  hear(from);
+}
+
+auto run_reader(int from, int to) -> void {
+  (void)from;
+  const int fd = vtpc_open(path, O_RDWR, 0);
+  vt::check(fd, "vtpc_open");
+  vt::expect(
+      read_at(fd, writer_offset, writer_data.size()) == writer_data,
+      "reader did not see what the writer wrote"
+  );
+  vt::check(
+      vtpc_pwrite(fd, reader_data.data(), reader_data.size(), reader_offset),
+      "vtpc_pwrite"
+  );
+  // Not the last close: the writer still has the file open.
+  vt::check(vtpc_close(fd), "vtpc_close");
+  say(to);
+}
+
+// Attaching to the cache cleans up after the peers that died.
+auto run_next(int from, int to) -> void {
+  (void)from;
+  const int fd = vtpc_open(other_path, O_RDWR | O_CREAT, 0644);  // NOLINT
+  vt::check(fd, "vtpc_open");
+  vt::check(vtpc_close(fd), "vtpc_close");
+  say(to);
+}
+
+}  // namespace
+
+auto main() -> int try {
+  const std::string shm = "/test_shm." + std::to_string(getpid());
+  setenv("VTPC_SHM", shm.c_str(), 1);  // NOLINT
+  setenv("VTPC_CAPACITY", "64", 1);    // NOLINT
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(std::string(8 * vt::block_size, 0));
+    file->sync();
+  }
+
+  const child writer = start(run_writer);
+  hear(writer.from);
+  const child reader = start(run_reader);
+  hear(reader.from);
+  vt::expect(succeeded(reader.pid), "reader failed");
+  say(writer.to);
+  hear(writer.from);
+
+  vt::expect(
+      on_disk(writer_offset, writer_data.size()) ==
+          std::string(writer_data.size(), 0),
+      "writer's blocks were written back before it was killed"
+  );
+  vt::check(kill(writer.pid, SIGKILL), "kill");
+  int status = 0;
+  vt::check(waitpid(writer.pid, &status, 0), "waitpid");
+
+  const child next = start(run_next);
+  hear(next.from);
+  vt::expect(succeeded(next.pid), "next process failed");
+  (void)shm_unlink(shm.c_str());
+
+  vt::expect(
+      on_disk(writer_offset, writer_data.size()) == writer_data,
+      "writer's dirty blocks not written back after it was killed"
+  );
+  vt::expect(
+      on_disk(reader_offset, reader_data.size()) == reader_data,
+      "reader's dirty blocks not written back after the writer was killed"
+  );
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
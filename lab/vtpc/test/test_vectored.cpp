@@ -0,0 +1,175 @@
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "cmp_file.hpp"
+#include "file.hpp"
+
+// Positional and vectored calls compared against libc: first the cases at
+// block boundaries and end of file, then a random mix of them with plain
+// reads, writes and seeks.
+
+namespace {
+
+constexpr size_t size = 5 * vt::block_size;
+const char* const libc_path = "/tmp/test_vectored.libc";
+const char* const vtpc_path = "/tmp/test_vectored.vtpc";
+
+// Segments of the given lengths laid out one after another in `buffer`.
+auto segments(std::string& buffer, const std::vector<size_t>& lengths)
+    -> std::vector<iovec> {
+  size_t total = 0;
+  for (const size_t length : lengths) {
+    total += length;
+  }
+  buffer.assign(total, 0);
+  std::vector<iovec> result;
+  size_t offset = 0;
+  for (const size_t length : lengths) {
+    result.push_back({buffer.data() + offset, length});
+    offset += length;
+  }
+  return result;
+}
+
+auto run_cases(vt::file& file) -> void {
+  std::string buffer;
+
+  // A pwrite and a pread straddling a block boundary.
+  const std::string across(100, 'p');
+  vt::expect(
+      file.pwrite(across.data(), across.size(), vt::block_size - 50) ==
+          across.size(),
+      "pwrite across a block boundary came up short"
+  );
+  buffer.assign(200, 0);
+  file.pread(buffer.data(), buffer.size(), vt::block_size - 100);
+
+  // A writev whose segments straddle boundaries, some empty, from a
+  // position inside a block, then a readv laid out differently.
+  std::string data((2 * vt::block_size) + 300, 0);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>('a' + (i % 26));
+  }
+  std::vector<iovec> write_segments;
+  for (const auto& [offset, length] : std::vector<std::pair<size_t, size_t>>{
+           {0, 10}, {10, 0}, {10, vt::block_size}, {vt::block_size + 10, 290},
+           {vt::block_size + 300, vt::block_size}}) {
+    write_segments.push_back({data.data() + offset, length});
+  }
+  file.seek((2 * vt::block_size) - 10);
+  vt::expect(
+      file.writev(write_segments) == data.size(),
+      "writev across blocks came up short"
+  );
+  file.seek((2 * vt::block_size) - 20);
+  file.readv(
+      segments(buffer, {1, 0, vt::block_size + 1, 17, vt::block_size, 600})
+  );
+
+  // Short reads at end of file, and reads past it.
+  const off_t end = static_cast<off_t>((4 * vt::block_size) + 290);
+  file.pread(buffer.data(), 100, end - 30);
+  vt::expect(
+      file.pread(buffer.data(), 100, end + 5000) == 0,
+      "pread past end of file read something"
+  );
+  file.seek(end - (2 * vt::block_size) - 7);
+  file.readv(
+      segments(buffer, {vt::block_size, vt::block_size, vt::block_size})
+  );
+  vt::expect(
+      file.readv(segments(buffer, {10, 10})) == 0,
+      "readv at end of file read something"
+  );
+
+  // Positional calls leave the position where it was.
+  file.seek(3);
+  file.pwrite("zz", 2, vt::block_size);
+  buffer.assign(10, 0);
+  file.pread(buffer.data(), 10, 0);
+  file.read(buffer.data(), 10);
+}
+
+auto run_random(vt::file& file) -> void {
+  constexpr size_t seed = 1;
+  constexpr size_t steps = (1U << 14U);
+
+  std::default_random_engine random(seed);  // NOLINT
+  std::uniform_int_distribution<size_t> action_dist(0, 100);  // NOLINT
+  std::uniform_int_distribution<off_t> offset_dist(0, size + vt::block_size);
+  std::uniform_int_distribution<size_t> batch_dist(0, vt::block_size + 100);
+  std::uniform_int_distribution<size_t> segments_dist(1, 8);  // NOLINT
+  std::uniform_int_distribution<uint8_t> char_dist(0);
+
+  const auto random_lengths = [&] {
+    std::vector<size_t> lengths(segments_dist(random));
+    for (size_t& length : lengths) {
+      length = batch_dist(random) / lengths.size();
+    }
+    return lengths;
+  };
+
+  std::string buffer;
+  for (size_t i = 0; i < steps; ++i) {
+    const size_t point = action_dist(random);
+    const off_t offset = offset_dist(random);
+    if (point < 25) {  // NOLINT
+      buffer.assign(batch_dist(random), 0);
+      file.pread(buffer.data(), buffer.size(), offset);
+    } else if (point < 45) {  // NOLINT
+      buffer.assign(batch_dist(random), 0);
+      for (char& c : buffer) {
+        c = static_cast<char>(char_dist(random));
+      }
+      file.pwrite(buffer.data(), buffer.size(), offset);
+    } else if (point < 65) {  // NOLINT
+      file.seek(offset);
+      file.readv(segments(buffer, random_lengths()));
+    } else if (point < 85) {  // NOLINT
+      const std::vector<iovec> parts = segments(buffer, random_lengths());
+      for (char& c : buffer) {
+        c = static_cast<char>(char_dist(random));
+      }
+      file.seek(offset);
+      file.writev(parts);
+    } else if (point < 95) {  // NOLINT
+      file.seek(offset);
+      buffer.assign(10, 0);
+      file.pread(buffer.data(), buffer.size(), 0);
+      // Whatever the position, a short read compares too.
+      file.readv(segments(buffer, {batch_dist(random)}));
+    } else {
+      file.sync();
+    }
+  }
+}
+
+}  // namespace
+
+auto main() -> int try {
+  (void)unlink(libc_path);
+  (void)unlink(vtpc_path);
+  auto libc = vt::file::open_libc(libc_path);
+  auto vtpc = vt::file::open_vtpc(vtpc_path);
+  vt::cmp_file cmp(std::move(libc), std::move(vtpc));
+
+  run_cases(cmp);
+  run_random(cmp);
+  cmp.sync();
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
@@ -0,0 +1,138 @@
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Read views on a cache of a few blocks: a viewed block stays while reads
+// of many others go through, writes show through the view, reads fail with
+// ENOBUFS once every block is viewed, and the handle cannot be closed
+// until the views are released.
+
+namespace {
+
+constexpr size_t capacity = 8;
+constexpr size_t blocks = capacity * 8;
+const char* const path = "/tmp/test_views";
+
+auto block_data(size_t block) -> std::string {
+  return std::string(vt::block_size, static_cast<char>('A' + (block % 26)));
+}
+
+auto view_text(const struct vtpc_view& view) -> std::string {
+  return {static_cast<const char*>(view.data), view.size};
+}
+
+}  // namespace
+
+auto main() -> int try {
+  const std::string capacity_text = std::to_string(capacity);
+  setenv("VTPC_CAPACITY", capacity_text.c_str(), 1);  // NOLINT
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    for (size_t i = 0; i < blocks; ++i) {
+      file->write(block_data(i));
+    }
+    file->sync();
+  }
+
+  const int fd = vtpc_open(path, O_RDWR, 0);
+  vt::check(fd, "vtpc_open");
+  vt::check(vtpc_fadvise(fd, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+
+  // The viewed block stays while every other block goes through the cache.
+  struct vtpc_view view{};
+  vt::check(vtpc_read_view(fd, 0, vt::block_size, &view), "vtpc_read_view");
+  vt::expect(
+      view.size == vt::block_size, "view of a whole block came up short"
+  );
+  vt::expect(view_text(view) == block_data(0), "view read back wrong");
+  std::string buffer(vt::block_size, 0);
+  for (size_t i = 1; i < blocks; ++i) {
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, i * vt::block_size),
+        "vtpc_pread"
+    );
+  }
+  vt::expect(view_text(view) == block_data(0), "view changed under eviction");
+  struct vtpc_stats before{};
+  vt::check(vtpc_stats(fd, &before), "vtpc_stats");
+  vt::check(vtpc_pread(fd, buffer.data(), vt::block_size, 0), "vtpc_pread");
+  struct vtpc_stats after{};
+  vt::check(vtpc_stats(fd, &after), "vtpc_stats");
+  vt::expect(
+      after.hits - before.hits == 1 && after.misses == before.misses,
+      "viewed block was evicted"
+  );
+
+  // A write into the block shows through the view.
+  const std::string written = "written through vtpc";
+  vt::check(
+      vtpc_pwrite(fd, written.data(), written.size(), 100), "vtpc_pwrite"
+  );
+  vt::expect(
+      view_text(view).compare(100, written.size(), written) == 0,
+      "write did not show through the view"
+  );
+
+  // The handle cannot be closed while it has views.
+  errno = 0;
+  vt::expect(
+      vtpc_close(fd) == -1 && errno == EBUSY,
+      "close with a view held did not fail with EBUSY"
+  );
+
+  // Once every block is viewed, nothing can be read into the cache.
+  std::vector<struct vtpc_view> views(capacity - 1);
+  for (size_t i = 0; i < views.size(); ++i) {
+    vt::check(
+        vtpc_read_view(fd, (i + 1) * vt::block_size, 1, &views[i]),
+        "vtpc_read_view"
+    );
+  }
+  errno = 0;
+  const off_t next = capacity * vt::block_size;
+  vt::expect(
+      vtpc_pread(fd, buffer.data(), vt::block_size, next) == -1 &&
+          errno == ENOBUFS,
+      "read with every block viewed did not fail with ENOBUFS"
+  );
+  struct vtpc_view extra{};
+  errno = 0;
+  vt::expect(
+      vtpc_read_view(fd, next, 1, &extra) == -1 && errno == ENOBUFS,
+      "view with every block viewed did not fail with ENOBUFS"
+  );
+  vt::check(vtpc_release(&views.back()), "vtpc_release");
+  vt::check(
+      vtpc_pread(fd, buffer.data(), vt::block_size, next), "vtpc_pread"
+  );
+  vt::expect(
+      buffer == block_data(capacity), "read after a release read back wrong"
+  );
+
+  for (size_t i = 0; i + 1 < views.size(); ++i) {
+    vt::check(vtpc_release(&views[i]), "vtpc_release");
+  }
+  vt::check(vtpc_release(&view), "vtpc_release");
+  vt::check(vtpc_close(fd), "vtpc_close");
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}
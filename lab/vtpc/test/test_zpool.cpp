@@ -0,0 +1,104 @@
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "check.hpp"
+#include "exception.hpp"
+#include "file.hpp"
+
+extern "C" {
+#include <fcntl.h>
+
+#include "vtpc.h"
+}
+
+// Reads a file eight times the size of the cache through a compressed tier
+// that holds all of it, overwrites part of it and reads it again, checking
+// every block against a copy: blocks must come back from the tier as they
+// went in, and a write must not leave an older copy behind there.
+
+namespace {
+
+constexpr size_t blocks = 256;
+const char* const path = "/tmp/test_zpool";
+
+// Runs of repeated words, different for every block and `round`, so that
+// blocks compress but no two are alike.
+auto make_block(size_t block, uint64_t round) -> std::string {
+  std::string data(vt::block_size, 0);
+  for (size_t i = 0; i < vt::block_size / sizeof(uint64_t); ++i) {
+    const uint64_t word = (round << 48U) | (block << 16U) | (i / 16);
+    std::memcpy(data.data() + (i * sizeof(word)), &word, sizeof(word));
+  }
+  return data;
+}
+
+auto read_all(int fd, const std::string& expected) -> void {
+  std::string buffer(vt::block_size, 0);
+  for (size_t i = 0; i < blocks; ++i) {
+    const off_t offset = static_cast<off_t>(i * vt::block_size);
+    vt::check(
+        vtpc_pread(fd, buffer.data(), vt::block_size, offset), "vtpc_pread"
+    );
+    if (expected.compare(offset, vt::block_size, buffer) != 0) {
+      throw vt::exception() << "block " << i << " read back wrong";
+    }
+  }
+}
+
+}  // namespace
+
+auto main() -> int try {
+  setenv("VTPC_CAPACITY", "32", 1);  // NOLINT
+  setenv("VTPC_ZPOOL", "256", 1);    // NOLINT
+
+  std::string expected;
+  for (size_t i = 0; i < blocks; ++i) {
+    expected += make_block(i, 0);
+  }
+  {
+    auto file = vt::file::open_libc(path);
+    file->seek(0);
+    file->write(expected);
+    file->sync();
+  }
+
+  const int fd = vtpc_open(path, O_RDWR, 0);
+  vt::check(fd, "vtpc_open");
+  vt::check(vtpc_fadvise(fd, 0, 0, POSIX_FADV_RANDOM), "vtpc_fadvise");
+  read_all(fd, expected);
+  read_all(fd, expected);
+  struct vtpc_stats stats{};
+  vt::check(vtpc_stats(fd, &stats), "vtpc_stats");
+  if (stats.compressed_hits == 0) {
+    throw vt::exception() << "no block came from the compressed tier";
+  }
+
+  for (size_t i = 0; i < blocks; i += 3) {
+    const std::string block = make_block(i, 1);
+    const off_t offset = static_cast<off_t>(i * vt::block_size);
+    vt::check(
+        vtpc_pwrite(fd, block.data(), vt::block_size, offset), "vtpc_pwrite"
+    );
+    expected.replace(offset, vt::block_size, block);
+  }
+  read_all(fd, expected);
+  read_all(fd, expected);
+  vt::check(vtpc_close(fd), "vtpc_close");
+
+  auto file = vt::file::open_libc(path);
+  file->seek(0);
+  if (file->read(expected.size()) != expected) {
+    throw vt::exception() << "file written back wrong";
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::cerr << "exception: " << e.what() << '\n';
+  return 1;
+}